@@ -0,0 +1,243 @@
+// Checks for the wire protocol helpers shared by the server and client. Each
+// check prints what failed and the run exits non-zero if any did
+
+// u_short, which WinSock2.h gives us on Windows
+#include <sys/types.h>
+
+// Standard library
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Project includes
+#include "../Common/common.h"
+#include "../GameServer/PlayerProtocol.h"
+#include "../GameServer/TimerWheel.h"
+
+using namespace AmazingRPG;
+
+static int s_failures{ 0 };
+
+static void Check(bool passed, const char* description)
+{
+    if (!passed)
+    {
+        std::cout << "FAILED: " << description << std::endl;
+        ++s_failures;
+    }
+}
+
+static bool IsRedirect(const std::string& reply)
+{
+    std::string host;
+    unsigned short port{ 0 };
+    return ParseRedirect(reply, host, port);
+}
+
+static void TestRedirect()
+{
+    std::string host;
+    unsigned short port{ 0 };
+    Check(ParseRedirect(EncodeRedirect("node2.example.com", 27016), host, port), "an encoded redirect parses");
+    Check(host == "node2.example.com" && port == 27016, "the redirect host and port round trip");
+
+    // the replies the server sends as plain text must never be taken for a redirect
+    std::string playerID{ GetPlayerIDForInt(42) };
+    Check(!IsRedirect("Request for player ID " + playerID + " timed out"), "a timeout reply isn't a redirect");
+    Check(!IsRedirect("Unable to find player ID " + playerID), "a not found reply isn't a redirect");
+    Check(!IsRedirect("Request for player ID " + playerID + " timed out\n"), "a terminated timeout reply isn't a redirect");
+
+    // truncated or malformed frames
+    std::string redirect{ EncodeRedirect("host", 27015) };
+    Check(!IsRedirect(redirect.substr(0, redirect.size() - 1)), "a redirect without its terminator is rejected");
+    Check(!IsRedirect(redirect + redirect), "two redirects in one frame are rejected");
+    Check(!IsRedirect(std::string{ REDIRECT } + ":27015\n"), "a redirect without a host is rejected");
+    Check(!IsRedirect(std::string{ REDIRECT } + "host:\n"), "a redirect without a port is rejected");
+    Check(!IsRedirect(std::string{ REDIRECT } + "host:0\n"), "port 0 is rejected");
+    Check(!IsRedirect(std::string{ REDIRECT } + "host:65536\n"), "a port past 65535 is rejected");
+    Check(!IsRedirect(std::string{ REDIRECT } + "host:27x15\n"), "a port with letters is rejected");
+    Check(!IsRedirect(std::string{ REDIRECT } + "ho st:27015\n"), "a host with spaces is rejected");
+}
+
+static void TestContinuationToken()
+{
+    const std::string playerID{ GetPlayerIDForInt(7) };
+    std::string lastItemID;
+    Check(DecodeContinuationToken(EncodeContinuationToken(playerID, "item00000099"), playerID, lastItemID) && lastItemID == "item00000099",
+        "a continuation token round trips");
+    Check(EncodeContinuationToken(playerID, "").empty(), "a finished listing has an empty token");
+    Check(DecodeContinuationToken("", playerID, lastItemID) && lastItemID.empty(), "an empty token starts from the first item");
+    Check(!DecodeContinuationToken(EncodeContinuationToken(playerID, "item00000099"), GetPlayerIDForInt(8), lastItemID),
+        "a token is turned down for another player");
+    Check(!DecodeContinuationToken(std::string{ INVENTORY_CANCEL }, playerID, lastItemID), "the cancel token isn't a continuation token");
+    Check(!DecodeContinuationToken("zz", playerID, lastItemID), "a token that isn't hex is turned down");
+}
+
+static void TestGrantLimits()
+{
+    GrantRequest grantRequest;
+    std::string error;
+    const std::string playerID{ GetPlayerIDForInt(7) };
+    const std::string maxAmount{ std::to_string(MAX_GRANT_AMOUNT) };
+    Check(ParseGrantRequest(("GS-" + maxAmount + ":" + playerID).c_str(), 4 + maxAmount.size() + playerID.size(), grantRequest, error)
+        && grantRequest.amount == -MAX_GRANT_AMOUNT, "a grant of the largest amount is accepted");
+    const std::string overAmount{ std::to_string(MAX_GRANT_AMOUNT + 1) };
+    Check(!ParseGrantRequest(("GS" + overAmount + ":" + playerID).c_str(), 3 + overAmount.size() + playerID.size(), grantRequest, error),
+        "a grant past the largest amount is turned down");
+
+    long long value{ 0 };
+    Check(ParseInteger("2147483647", INT_MIN, INT_MAX, value) && value == INT_MAX, "the largest int parses");
+    Check(!ParseInteger("2147483648", INT_MIN, INT_MAX, value), "a stat past an int is turned down");
+    Check(!ParseInteger("99999999999999999999", INT_MIN, INT_MAX, value), "a number past a long long is turned down");
+    Check(!ParseInteger("12abc", INT_MIN, INT_MAX, value) && !ParseInteger("", INT_MIN, INT_MAX, value), "text that isn't a number is turned down");
+    // a whole grant of failures still fits in one reply, a line per player
+    std::string reply;
+    for (size_t playerIdx{ 0 }; playerIdx < MAX_GRANT_PLAYERS; ++playerIdx)
+    {
+        AppendGrantResult(reply, GetPlayerIDForInt(static_cast<int>(playerIdx)), "failed: " + std::string(500, 'x'));
+    }
+    Check(reply.size() + 1 <= SOCKET_BUFFER_SIZE, "the worst case grant reply and its REPLY_END fit in the socket buffer");
+    Check(static_cast<size_t>(std::count(reply.begin(), reply.end(), '\n')) == MAX_GRANT_PLAYERS, "every player keeps their line");
+
+    unsigned long long version{ 0 };
+    Check(ParseUnsigned("18446744073709551615", version) && !ParseUnsigned("-1", version), "versions parse as unsigned");
+}
+
+static void TestReplyEnd()
+{
+    // a text reply is only over at its REPLY_END, however it was split up
+    const std::string textReply{ "Unable to find player ID " + GetPlayerIDForInt(42) + REPLY_END };
+    Check(FindReplyEnd(textReply.substr(0, 10), VIEW) == std::string::npos, "the first part of a text reply isn't the whole of it");
+    Check(FindReplyEnd(textReply + "D", VIEW) == textReply.size() - 1, "a text reply ends at its REPLY_END");
+
+    // versioned deltas are binary, so a value holding REPLY_END mustn't end them early
+    std::string delta{ VERSIONED_DELTA };
+    AppendLittleEndian(delta, 7, VERSION_SIZE);
+    delta += static_cast<char>(2);
+    delta += STR;
+    AppendLittleEndian(delta, static_cast<unsigned char>(REPLY_END), DELTA_VALUE_SIZE);
+    delta += INT;
+    AppendLittleEndian(delta, 0x03030303, DELTA_VALUE_SIZE);
+    Check(FindReplyEnd(delta, VIEW_IF_NEWER) == std::string::npos, "a versioned delta waits for its REPLY_END");
+    Check(FindReplyEnd(delta.substr(0, 5), VIEW_IF_NEWER) == std::string::npos, "a versioned delta waits for its header");
+    Check(FindReplyEnd(delta + REPLY_END, VIEW_IF_NEWER) == delta.size(), "a versioned delta ends after its fields");
+    Check(FindReplyEnd(std::string{ NOT_MODIFIED, REPLY_END }, VIEW_IF_NEWER) == 1, "a not modified reply ends at its REPLY_END");
+}
+
+// Advances the wheel a tick at a time up to lastTick, so each callback sees the tick it fired on
+static void AdvanceTo(TimerWheel& timers, TimerWheel::Clock::time_point startTime, uint64_t& currentTick, uint64_t lastTick)
+{
+    while (currentTick < lastTick)
+    {
+        ++currentTick;
+        timers.Advance(startTime + std::chrono::milliseconds{ 10 } * static_cast<long long>(currentTick));
+    }
+}
+
+static void TestTimerWheel()
+{
+    const std::chrono::milliseconds TICK{ 10 };
+    const TimerWheel::Clock::time_point startTime{};
+    uint64_t currentTick{ 0 };
+
+    // timers on every level fire on their own tick, however many cascades it takes to get there
+    {
+        TimerWheel timers{ TICK, startTime };
+        currentTick = 0;
+        const std::vector<uint64_t> delayTicks{ 1, 255, 256, 300, 16383, 16384, 20000, (1ull << 20) + 37 };
+        std::vector<uint64_t> firedTicks(delayTicks.size(), 0);
+        for (size_t timerIdx{ 0 }; timerIdx < delayTicks.size(); ++timerIdx)
+        {
+            timers.Schedule(TICK * static_cast<long long>(delayTicks[timerIdx]), [&firedTicks, &currentTick, timerIdx]() { firedTicks[timerIdx] = currentTick; });
+        }
+        // and one armed part way through a turn of the wheel
+        uint64_t lateFiredTick{ 0 };
+        timers.Schedule(TICK * 100, [&timers, &lateFiredTick, &currentTick, TICK]()
+        {
+            timers.Schedule(TICK * 16500, [&lateFiredTick, &currentTick]() { lateFiredTick = currentTick; });
+        });
+        AdvanceTo(timers, startTime, currentTick, delayTicks.back() + 1);
+        Check(firedTicks == delayTicks, "every timer fires on the tick it was due");
+        Check(lateFiredTick == 16600, "a timer armed mid turn fires on the tick it was due");
+        Check(timers.GetTimerCount() == 0, "one shot timers are gone once they fire");
+    }
+
+    // a delay rounds up to whole ticks and the wait until then to whole milliseconds
+    {
+        TimerWheel timers{ TICK, startTime };
+        timers.Schedule(std::chrono::milliseconds{ 15 }, []() {});
+        Check(timers.GetTimeUntilNextTimer(startTime + std::chrono::microseconds{ 5500 }, std::chrono::seconds{ 1 }) == std::chrono::milliseconds{ 15 },
+            "the wait until a timer rounds up");
+        Check(timers.Advance(startTime + std::chrono::milliseconds{ 19 }) == 0, "a timer doesn't fire before its tick");
+        Check(timers.Advance(startTime + std::chrono::milliseconds{ 20 }) == 1, "a timer fires on its tick");
+    }
+
+    // cancelled timers never fire and their IDs go stale
+    {
+        TimerWheel timers{ TICK, startTime };
+        currentTick = 0;
+        int fired{ 0 };
+        TimerID nearTimer{ timers.Schedule(TICK * 5, [&fired]() { ++fired; }) };
+        TimerID farTimer{ timers.Schedule(TICK * 20000, [&fired]() { ++fired; }) };
+        Check(timers.Cancel(nearTimer) && timers.Cancel(farTimer), "armed timers cancel");
+        Check(!timers.Cancel(nearTimer) && !timers.Cancel(INVALID_TIMER), "a timer only cancels once");
+        Check(timers.GetTimerCount() == 0, "cancelled timers aren't counted");
+
+        TimerID firedTimer{ timers.Schedule(TICK * 2, [&fired]() { ++fired; }) };
+        AdvanceTo(timers, startTime, currentTick, 20001);
+        Check(fired == 1, "only the timer left armed fires");
+        Check(!timers.Cancel(firedTimer), "a timer that fired can't be cancelled");
+
+        // the next timer reuses the fired one's slot in the pool, the old ID mustn't reach it
+        TimerID reusedTimer{ timers.Schedule(TICK * 2, [&fired]() { ++fired; }) };
+        Check(!timers.Cancel(firedTimer), "a stale ID doesn't cancel the timer that reused its node");
+        AdvanceTo(timers, startTime, currentTick, currentTick + 2);
+        Check(fired == 2 && reusedTimer != firedTimer, "the timer that reused the node still fires");
+    }
+
+    // re-arming moves a timer later, and repeating timers re-arm themselves
+    {
+        TimerWheel timers{ TICK, startTime };
+        currentTick = 0;
+        std::vector<uint64_t> firedTicks;
+        TimerID timer{ timers.Schedule(TICK * 50, [&firedTicks, &currentTick]() { firedTicks.push_back(currentTick); }) };
+        AdvanceTo(timers, startTime, currentTick, 30);
+        timers.Cancel(timer);
+        timer = timers.Schedule(TICK * 50, [&firedTicks, &currentTick]() { firedTicks.push_back(currentTick); });
+        AdvanceTo(timers, startTime, currentTick, 100);
+        Check(firedTicks == std::vector<uint64_t>{ 80 }, "a re-armed timer fires once, at its new time");
+
+        firedTicks.clear();
+        TimerID repeatingTimer{ INVALID_TIMER };
+        repeatingTimer = timers.ScheduleRepeating(TICK * 300, [&timers, &repeatingTimer, &firedTicks, &currentTick]()
+        {
+            firedTicks.push_back(currentTick);
+            if (firedTicks.size() == 3)
+            {
+                timers.Cancel(repeatingTimer);
+            }
+        });
+        AdvanceTo(timers, startTime, currentTick, 2000);
+        Check(firedTicks == std::vector<uint64_t>{ 400, 700, 1000 }, "a repeating timer fires every interval until it's cancelled");
+        Check(timers.GetTimerCount() == 0, "a repeating timer cancelled from its callback is gone");
+    }
+}
+
+int main()
+{
+    TestRedirect();
+    TestContinuationToken();
+    TestGrantLimits();
+    TestReplyEnd();
+    TestTimerWheel();
+    if (s_failures > 0)
+    {
+        std::cout << s_failures << " checks failed" << std::endl;
+        return 1;
+    }
+    std::cout << "All checks passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,431 @@
+// Microbenchmarks for the game server hot paths. Storage is never touched, the
+// DynamoDB benchmarks only build and read the SDK request/response objects.
+// Every benchmark reports allocs/op and bytes/op next to the usual time per op
+
+// u_short, which WinSock2.h gives us on Windows
+#include <sys/types.h>
+
+// Standard library
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <vector>
+
+// Google Benchmark
+#include <benchmark/benchmark.h>
+
+// Project includes
+#include "../Common/common.h"
+#include "../GameServer/ConnectionTable.h"
+#include "../GameServer/HotKeys.h"
+#include "../GameServer/PlayerFilter.h"
+#include "../GameServer/TimerWheel.h"
+#include "../GameServer/PlayerProtocol.h"
+
+#if AMAZINGRPG_BENCHMARK_AWSSDK
+// AWS C++ SDK
+#include <aws/core/Aws.h>
+#include <aws/dynamodb/model/AttributeValue.h>
+
+#include "../GameServer/PlayerTable.h"
+#endif
+
+//////////////////////////////////////////////////////////////////////////////
+// Allocation tracking, every allocation in the process goes through here
+static std::atomic<size_t> s_allocationCount{ 0 };
+static std::atomic<size_t> s_allocationBytes{ 0 };
+
+// The replacements are kept out of line. GCC otherwise inlines the free into
+// delete expressions and, seeing it paired with a builtin operator new, warns
+// with -Wmismatched-new-delete even though the pair here is malloc and free
+__attribute__((noinline)) void* operator new(size_t size)
+{
+    ++s_allocationCount;
+    s_allocationBytes += size;
+    if (void* memory = std::malloc(size == 0 ? 1 : size))
+    {
+        return memory;
+    }
+    throw std::bad_alloc();
+}
+
+__attribute__((noinline)) void* operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+__attribute__((noinline)) void operator delete(void* memory) noexcept
+{
+    std::free(memory);
+}
+
+__attribute__((noinline)) void operator delete(void* memory, size_t) noexcept
+{
+    std::free(memory);
+}
+
+__attribute__((noinline)) void operator delete[](void* memory) noexcept
+{
+    std::free(memory);
+}
+
+__attribute__((noinline)) void operator delete[](void* memory, size_t) noexcept
+{
+    std::free(memory);
+}
+
+namespace AmazingRPG
+{
+    // Counts the allocations made while the benchmark loop runs and reports them per iteration
+    class AllocationCounter
+    {
+    public:
+        explicit AllocationCounter(benchmark::State& state)
+            : m_state{ state }
+            , m_startCount{ s_allocationCount }
+            , m_startBytes{ s_allocationBytes }
+        {
+        }
+
+        ~AllocationCounter()
+        {
+            m_state.counters["allocs/op"] = benchmark::Counter(static_cast<double>(s_allocationCount - m_startCount), benchmark::Counter::kAvgIterations);
+            m_state.counters["bytes/op"] = benchmark::Counter(static_cast<double>(s_allocationBytes - m_startBytes), benchmark::Counter::kAvgIterations);
+        }
+
+    private:
+        benchmark::State& m_state;
+        size_t m_startCount;
+        size_t m_startBytes;
+    };
+
+    PlayerDesc MakeBenchmarkPlayer(int id)
+    {
+        PlayerDesc playerDesc;
+        playerDesc.id = GetPlayerIDForInt(id);
+        playerDesc.level = 42;
+        playerDesc.strength = 12;
+        playerDesc.intellect = 15;
+        return playerDesc;
+    }
+
+    //////////////////////////////////////////////////////////////////////////////
+    // Protocol
+    void BM_GetPlayerIDForInt(benchmark::State& state)
+    {
+        int id{ 0 };
+        AllocationCounter allocations{ state };
+        for (auto _ : state)
+        {
+            benchmark::DoNotOptimize(GetPlayerIDForInt(id++));
+        }
+    }
+    BENCHMARK(BM_GetPlayerIDForInt);
+
+    void BM_PlayerDescGetString(benchmark::State& state)
+    {
+        PlayerDesc playerDesc{ MakeBenchmarkPlayer(123456) };
+        AllocationCounter allocations{ state };
+        for (auto _ : state)
+        {
+            benchmark::DoNotOptimize(playerDesc.GetString());
+        }
+    }
+    BENCHMARK(BM_PlayerDescGetString);
+
+    void BM_ParsePlayerRequest(benchmark::State& state)
+    {
+        std::string buffer{ VIEW + GetPlayerIDForInt(123456) };
+        PlayerRequest request;
+        std::string error;
+        AllocationCounter allocations{ state };
+        for (auto _ : state)
+        {
+            benchmark::DoNotOptimize(ParsePlayerRequest(buffer.data(), buffer.size(), request, error));
+        }
+    }
+    BENCHMARK(BM_ParsePlayerRequest);
+
+    void BM_ParseGrantRequest(benchmark::State& state)
+    {
+        std::string buffer{ GRANT };
+        buffer += STR;
+        buffer += "-5";
+        buffer += GRANT_AMOUNT_END;
+        for (int64_t playerIdx{ 0 }; playerIdx < state.range(0); ++playerIdx)
+        {
+            buffer += GetPlayerIDForInt(static_cast<int>(playerIdx));
+        }
+
+        GrantRequest request;
+        std::string error;
+        AllocationCounter allocations{ state };
+        for (auto _ : state)
+        {
+            benchmark::DoNotOptimize(ParseGrantRequest(buffer.data(), buffer.size(), request, error));
+        }
+    }
+    BENCHMARK(BM_ParseGrantRequest)->Arg(1)->Arg(25)->Arg(static_cast<int64_t>(MAX_GRANT_PLAYERS));
+
+    void BM_EncodePlayerDelta(benchmark::State& state)
+    {
+        std::string playerID{ GetPlayerIDForInt(123456) };
+        std::map<char, int> fields{ { STR, 12 }, { INT, 15 } };
+        AllocationCounter allocations{ state };
+        for (auto _ : state)
+        {
+            benchmark::DoNotOptimize(EncodePlayerDelta(playerID, fields));
+        }
+    }
+    BENCHMARK(BM_EncodePlayerDelta);
+
+    // a client refreshing after one stat changed
+    void BM_EncodeVersionedDelta(benchmark::State& state)
+    {
+        std::map<char, int> fields{ { STR, 12 } };
+        AllocationCounter allocations{ state };
+        for (auto _ : state)
+        {
+            benchmark::DoNotOptimize(EncodeVersionedDelta(42, fields));
+        }
+    }
+    BENCHMARK(BM_EncodeVersionedDelta);
+
+    // one full page of an inventory listing and the token that ends it
+    void BM_EncodeInventoryPage(benchmark::State& state)
+    {
+        std::vector<InventoryItem> items;
+        for (int itemIdx{ 0 }; itemIdx < 100; ++itemIdx)
+        {
+            items.push_back({ "item" + std::to_string(10000000 + itemIdx), "Health Potion", 1 + itemIdx % 5 });
+        }
+
+        const std::string playerID{ GetPlayerIDForInt(42) };
+
+        AllocationCounter allocations{ state };
+        for (auto _ : state)
+        {
+            std::string message;
+            for (const InventoryItem& item : items)
+            {
+                AppendInventoryItem(message, item);
+            }
+            AppendInventoryEnd(message, EncodeContinuationToken(playerID, items.back().itemID));
+            benchmark::DoNotOptimize(message);
+        }
+    }
+    BENCHMARK(BM_EncodeInventoryPage);
+
+    //////////////////////////////////////////////////////////////////////////////
+    // Connection table
+
+    // the server's SocketInformation minus the Windows socket types
+    using BenchmarkSocketInformation = Connection<int>;
+
+    // one client disconnects and another connects, with range(0) connections open
+    void BM_RemoveConnections(benchmark::State& state)
+    {
+        std::vector<BenchmarkSocketInformation> socketList(static_cast<size_t>(state.range(0)));
+        for (size_t socketIdx{ 0 }; socketIdx < socketList.size(); ++socketIdx)
+        {
+            socketList[socketIdx].socket = static_cast<int>(socketIdx);
+        }
+
+        int nextSocket{ static_cast<int>(socketList.size()) };
+        std::vector<BenchmarkSocketInformation> socketsToFree(1);
+        AllocationCounter allocations{ state };
+        for (auto _ : state)
+        {
+            // the oldest connection is at the front, so this is the worst case for the erase
+            socketsToFree[0].socket = socketList.front().socket;
+            RemoveConnections(socketList, socketsToFree);
+
+            BenchmarkSocketInformation socketInfo;
+            socketInfo.socket = nextSocket++;
+            socketList.push_back(socketInfo);
+        }
+    }
+    BENCHMARK(BM_RemoveConnections)->Arg(16)->Arg(256)->Arg(1024);
+
+    //////////////////////////////////////////////////////////////////////////////
+    // Hot keys
+
+    // every request goes through the detector, one in ten is for the same celebrity player
+    void BM_HotKeyRecord(benchmark::State& state)
+    {
+        HotKeyDetector detector{ 2048, 4, 16, 50, 10000 };
+        std::vector<std::string> playerIDs;
+        for (int playerIdx{ 0 }; playerIdx < 1000; ++playerIdx)
+        {
+            playerIDs.push_back(playerIdx % 10 == 0 ? GetPlayerIDForInt(0) : GetPlayerIDForInt(playerIdx));
+        }
+
+        size_t requestIdx{ 0 };
+        AllocationCounter allocations{ state };
+        for (auto _ : state)
+        {
+            benchmark::DoNotOptimize(detector.Record(playerIDs[requestIdx]));
+            requestIdx = (requestIdx + 1) % playerIDs.size();
+        }
+    }
+    BENCHMARK(BM_HotKeyRecord);
+
+    //////////////////////////////////////////////////////////////////////////////
+    // Missing player filter
+
+    // half the lookups are for players that don't exist, range(0) is 0 for numeric IDs and 1 for named ones
+    void BM_PlayerFilterMightExist(benchmark::State& state)
+    {
+        PlayerExistenceFilter filter{ 1ull << 24, 100000, 0.01 };
+        std::vector<std::string> playerIDs;
+        for (int playerIdx{ 0 }; playerIdx < 200000; ++playerIdx)
+        {
+            std::string playerID{ state.range(0) == 0 ? GetPlayerIDForInt(playerIdx) : "player-" + std::to_string(playerIdx) };
+            if (playerIdx % 2 == 0)
+            {
+                filter.Add(playerID);
+            }
+            playerIDs.push_back(playerID);
+        }
+
+        size_t requestIdx{ 0 };
+        AllocationCounter allocations{ state };
+        for (auto _ : state)
+        {
+            benchmark::DoNotOptimize(filter.MightExist(playerIDs[requestIdx]));
+            requestIdx = (requestIdx + 1) % playerIDs.size();
+        }
+    }
+    BENCHMARK(BM_PlayerFilterMightExist)->Arg(0)->Arg(1);
+
+    //////////////////////////////////////////////////////////////////////////////
+    // Timers
+
+    // a read on one connection moves its idle timeout, with range(0) other timers armed
+    void BM_TimerWheelRearm(benchmark::State& state)
+    {
+        auto startTime{ std::chrono::steady_clock::now() };
+        TimerWheel timers{ std::chrono::milliseconds{ 10 }, startTime };
+        std::vector<TimerID> timerIDs;
+        for (int64_t timerIdx{ 0 }; timerIdx < state.range(0); ++timerIdx)
+        {
+            timerIDs.push_back(timers.Schedule(std::chrono::milliseconds{ 1000 + timerIdx % 120000 }, [] {}));
+        }
+
+        size_t timerIdx{ 0 };
+        AllocationCounter allocations{ state };
+        for (auto _ : state)
+        {
+            timers.Cancel(timerIDs[timerIdx]);
+            timerIDs[timerIdx] = timers.Schedule(std::chrono::milliseconds{ 120000 }, [] {});
+            timerIdx = (timerIdx + 1) % timerIDs.size();
+        }
+    }
+    BENCHMARK(BM_TimerWheelRearm)->Arg(1000)->Arg(100000)->Arg(500000);
+
+    // the server loop's tick with range(0) connections whose idle timeouts are spread over two minutes
+    void BM_TimerWheelAdvance(benchmark::State& state)
+    {
+        auto startTime{ std::chrono::steady_clock::now() };
+        TimerWheel timers{ std::chrono::milliseconds{ 10 }, startTime };
+        const std::chrono::milliseconds IDLE_TIMEOUT{ 120000 };
+        std::function<void()> rearm = [&timers, &rearm, IDLE_TIMEOUT] { timers.Schedule(IDLE_TIMEOUT, rearm); };
+        for (int64_t timerIdx{ 0 }; timerIdx < state.range(0); ++timerIdx)
+        {
+            timers.Schedule(std::chrono::milliseconds{ timerIdx * IDLE_TIMEOUT.count() / state.range(0) }, rearm);
+        }
+
+        auto now{ startTime };
+        AllocationCounter allocations{ state };
+        for (auto _ : state)
+        {
+            now += std::chrono::milliseconds{ 10 };
+            benchmark::DoNotOptimize(timers.Advance(now));
+        }
+    }
+    BENCHMARK(BM_TimerWheelAdvance)->Arg(1000)->Arg(100000)->Arg(500000);
+
+#if AMAZINGRPG_BENCHMARK_AWSSDK
+    //////////////////////////////////////////////////////////////////////////////
+    // DynamoDB requests and items
+    void BM_MakePlayerQueryRequest(benchmark::State& state)
+    {
+        std::string playerID{ GetPlayerIDForInt(123456) };
+        AllocationCounter allocations{ state };
+        for (auto _ : state)
+        {
+            auto queryRequest{ MakePlayerQueryRequest(playerID) };
+            benchmark::DoNotOptimize(queryRequest.SerializePayload());
+        }
+    }
+    BENCHMARK(BM_MakePlayerQueryRequest);
+
+    void BM_ReadPlayerDescFromItem(benchmark::State& state)
+    {
+        PlayerDesc source{ MakeBenchmarkPlayer(123456) };
+        Aws::Map<Aws::String, Aws::DynamoDB::Model::AttributeValue> item;
+        item[DATA_KEY_ID].SetS(source.id);
+        item[DATA_KEY_STRENGTH].SetN(std::to_string(source.strength));
+        item[DATA_KEY_INTELLECT].SetN(std::to_string(source.intellect));
+
+        PlayerDesc playerDesc;
+        AllocationCounter allocations{ state };
+        for (auto _ : state)
+        {
+            ReadPlayerDescFromItem(item, playerDesc);
+            benchmark::DoNotOptimize(playerDesc);
+        }
+    }
+    BENCHMARK(BM_ReadPlayerDescFromItem);
+
+    void BM_MakePlayerChunkWriteRequest(benchmark::State& state)
+    {
+        std::vector<PlayerDesc> playerChunk;
+        for (size_t playerIdx{ 0 }; playerIdx < MAX_DYNAMODB_BATCH_ITEMS; ++playerIdx)
+        {
+            playerChunk.push_back(MakeBenchmarkPlayer(static_cast<int>(playerIdx)));
+        }
+
+        AllocationCounter allocations{ state };
+        for (auto _ : state)
+        {
+            auto batchWriteRequest{ MakePlayerChunkWriteRequest(playerChunk) };
+            benchmark::DoNotOptimize(batchWriteRequest.SerializePayload());
+        }
+    }
+    BENCHMARK(BM_MakePlayerChunkWriteRequest);
+
+    void BM_MakeGrantRequest(benchmark::State& state)
+    {
+        std::string playerID{ GetPlayerIDForInt(123456) };
+        AllocationCounter allocations{ state };
+        for (auto _ : state)
+        {
+            auto updateItemRequest{ MakeGrantRequest(playerID, DATA_KEY_STRENGTH, 5) };
+            benchmark::DoNotOptimize(updateItemRequest.SerializePayload());
+        }
+    }
+    BENCHMARK(BM_MakeGrantRequest);
+#endif
+}
+
+int main(int argc, char** argv)
+{
+#if AMAZINGRPG_BENCHMARK_AWSSDK
+    Aws::SDKOptions options;
+    Aws::InitAPI(options);
+#endif
+
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv))
+    {
+        return 1;
+    }
+    benchmark::RunSpecifiedBenchmarks();
+
+#if AMAZINGRPG_BENCHMARK_AWSSDK
+    Aws::ShutdownAPI(options);
+#endif
+    return 0;
+}
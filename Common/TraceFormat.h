@@ -0,0 +1,113 @@
+#pragma once
+// Standard library
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Project includes
+#include "common.h"
+
+namespace AmazingRPG
+{
+    //////////////////////////////////////////////////////////////////////////////
+    // Traffic traces, recorded by the game server and played back by GameReplay.
+    // A trace is TRACE_MAGIC followed by one record per frame the server received:
+    //   uint64 microseconds since the recording started
+    //   uint32 connection ID, assigned by the server in the order clients connected
+    //   uint32 frame length, followed by the frame exactly as it came off the socket
+    // All integers are little endian.
+    const char TRACE_MAGIC[8]{ 'A', 'R', 'P', 'G', 'T', 'R', 'C', '1' };
+
+    struct TraceRecord
+    {
+        uint64_t timestampMicros{ 0 };
+        uint32_t connectionID{ 0 };
+        std::string frame;
+    };
+
+    class TraceWriter
+    {
+    public:
+        // starts the trace clock, so the first frame is recorded relative to this call
+        bool Open(const std::string& fileName)
+        {
+            m_file.open(fileName, std::ios::binary | std::ios::trunc);
+            if (!m_file)
+            {
+                return false;
+            }
+            m_file.write(TRACE_MAGIC, sizeof(TRACE_MAGIC));
+            m_startTime = std::chrono::steady_clock::now();
+            return static_cast<bool>(m_file);
+        }
+
+        bool IsOpen() const { return m_file.is_open(); }
+
+        void Write(uint32_t connectionID, const char* frame, size_t length)
+        {
+            auto elapsed{ std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - m_startTime) };
+            WriteInt(static_cast<uint64_t>(elapsed.count()), 8);
+            WriteInt(connectionID, 4);
+            WriteInt(length, 4);
+            m_file.write(frame, length);
+        }
+
+        void Flush() { m_file.flush(); }
+
+        // writes out what's buffered, IsOpen is false afterwards
+        void Close() { m_file.close(); }
+
+    private:
+        void WriteInt(uint64_t value, int byteCount)
+        {
+            std::string bytes;
+            AppendLittleEndian(bytes, value, byteCount);
+            m_file.write(bytes.data(), bytes.size());
+        }
+
+        std::ofstream m_file;
+        std::chrono::steady_clock::time_point m_startTime;
+    };
+
+    class TraceReader
+    {
+    public:
+        bool Open(const std::string& fileName)
+        {
+            m_file.open(fileName, std::ios::binary);
+            char magic[sizeof(TRACE_MAGIC)];
+            return m_file.read(magic, sizeof(magic)) && std::equal(magic, magic + sizeof(magic), TRACE_MAGIC);
+        }
+
+        // false at the end of the trace, or if the last record was cut short
+        bool Read(TraceRecord& record)
+        {
+            uint64_t connectionID{ 0 };
+            uint64_t length{ 0 };
+            if (!ReadInt(record.timestampMicros, 8) || !ReadInt(connectionID, 4) || !ReadInt(length, 4))
+            {
+                return false;
+            }
+            record.connectionID = static_cast<uint32_t>(connectionID);
+            record.frame.resize(static_cast<size_t>(length));
+            return length == 0 || static_cast<bool>(m_file.read(&record.frame[0], length));
+        }
+
+    private:
+        bool ReadInt(uint64_t& value, int byteCount)
+        {
+            char bytes[8];
+            if (!m_file.read(bytes, byteCount))
+            {
+                return false;
+            }
+            value = ReadLittleEndian(bytes, byteCount);
+            return true;
+        }
+
+        std::ifstream m_file;
+    };
+}
@@ -1,3 +1,13 @@
+#pragma once
+// Standard library
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+
 namespace AmazingRPG
 {
     // per player data
@@ -7,6 +17,8 @@ namespace AmazingRPG
         int level{ 1 };
         int strength{ 0 };
         int intellect{ 0 };
+        // goes up by one on every write to the player
+        unsigned long long version{ 0 };
     
         std::string GetString()
         {
@@ -15,10 +27,19 @@ namespace AmazingRPG
             sstrm << "\tLevel: " << level << std::endl;
             sstrm << "\tStrength: " << strength << std::endl;
             sstrm << "\tIntellect: " << intellect << std::endl;
+            sstrm << "\tVersion: " << version << std::endl;
             return sstrm.str();
         }
     };
 
+    // one entry in a player's inventory
+    struct InventoryItem
+    {
+        std::string itemID;
+        std::string name;
+        int count{ 0 };
+    };
+
     // shared socket settings
     const u_short PORT{ 27015 };
     const size_t SOCKET_BUFFER_SIZE = 8192;
@@ -33,6 +54,205 @@ namespace AmazingRPG
     const char VIEW{ 'V' }; // view player info
     const char STR{ 'S' };  // increment strength by 1
     const char INT{ 'I' };  // increment intellect by 1
+    const char SUBSCRIBE{ 'W' };    // watch a player, the server pushes their stat changes
+    const char UNSUBSCRIBE{ 'U' };  // stop watching a player
+
+    // view a player only if they changed: VIEW_IF_NEWER, 30 characters of ID, then the
+    // version the client already has. The reply is NOT_MODIFIED on its own, or
+    // VERSIONED_DELTA, the player's current version, a 1 byte field count and then a
+    // field code (STR or INT) and 4 byte value for each field changed since the client's
+    // version. Versions are VERSION_SIZE bytes, all integers are little endian
+    const char VIEW_IF_NEWER{ 'N' };
+    const char NOT_MODIFIED{ 'M' };
+    const char VERSIONED_DELTA{ 'X' };
+    const size_t VERSION_SIZE{ 8 };
+    const size_t DELTA_VALUE_SIZE{ 4 };
+
+    // grant a stat change to a group of players in one request:
+    // GRANT, the field code (STR or INT), the signed amount, GRANT_AMOUNT_END and
+    // then 30 characters of ID per player. The reply has one line per player, each
+    // at most MAX_GRANT_RESULT_SIZE characters so every player's line and the
+    // REPLY_END fit in one reply. Amounts are at most MAX_GRANT_AMOUNT either way, and a change that would
+    // take a stat outside an int fails for that player
+    const char GRANT{ 'G' };
+    const char GRANT_AMOUNT_END{ ':' };
+    const size_t MAX_GRANT_PLAYERS{ 100 };
+    const int MAX_GRANT_AMOUNT{ 1000000 };
+    const size_t MAX_GRANT_RESULT_SIZE{ (SOCKET_BUFFER_SIZE - 1) / MAX_GRANT_PLAYERS };
+    static_assert(MAX_GRANT_RESULT_SIZE > ID_SIZE + 32, "grant results need room for the player ID and a status");
+
+    // pushed by the server to subscribed clients whenever a watched player changes:
+    // PUSH_DELTA, 30 characters of ID, then one "<field code><value>;" per changed
+    // stat (field codes are STR and INT), terminated by PUSH_DELTA_END
+    const char PUSH_DELTA{ 'D' };
+    // reply from a cluster node that doesn't own the player: REDIRECT, "host:port" of
+    // the node that does and PUSH_DELTA_END. The client should reconnect there and
+    // resend. REDIRECT is a control character so no text reply can start with it
+    const char REDIRECT{ '\x1E' };
+    // sent to players watching for changes when nothing else has gone out for a while,
+    // followed by PUSH_DELTA_END, clients just drop it
+    const char KEEPALIVE{ 'K' };
+    const char PUSH_DELTA_END{ '\n' };
+    const char PUSH_DELTA_FIELD_END{ ';' };
+    // ends every reply to a request, however many receives it arrives in. Text replies
+    // never hold it but a VERSIONED_DELTA's binary fields can, so look for the end of a
+    // reply with FindReplyEnd
+    const char REPLY_END{ '\x03' };
+
+    // list a player's inventory: INVENTORY, 30 characters of ID and optionally the
+    // continuation token from an earlier reply to carry on from there. The server
+    // streams the items a page at a time, each as INVENTORY_ITEM then
+    // "<item ID>;<count>;<name>" and PUSH_DELTA_END, item IDs and names never hold
+    // either separator. The listing finishes with INVENTORY_END, a continuation token
+    // and PUSH_DELTA_END, an empty token means there are no more items. Tokens are
+    // opaque to the client and at most MAX_CONTINUATION_TOKEN_SIZE characters.
+    // Sending INVENTORY_CANCEL as the token stops a listing the client has given up
+    // on, the server answers with INVENTORY_END, INVENTORY_CANCEL and PUSH_DELTA_END
+    // once everything it had already queued has gone out
+    const char INVENTORY{ 'L' };
+    const char INVENTORY_ITEM{ 'T' };
+    const char INVENTORY_END{ 'E' };
+    const char INVENTORY_CANCEL{ '-' };
+    const size_t MAX_CONTINUATION_TOKEN_SIZE{ 128 };
+
+    inline void AppendLittleEndian(std::string& message, unsigned long long value, size_t byteCount)
+    {
+        for (size_t byteIdx{ 0 }; byteIdx < byteCount; ++byteIdx)
+        {
+            message += static_cast<char>((value >> (8 * byteIdx)) & 0xFF);
+        }
+    }
+
+    inline unsigned long long ReadLittleEndian(const char* bytes, size_t byteCount)
+    {
+        unsigned long long value{ 0 };
+        for (size_t byteIdx{ 0 }; byteIdx < byteCount; ++byteIdx)
+        {
+            value |= static_cast<unsigned long long>(static_cast<unsigned char>(bytes[byteIdx])) << (8 * byteIdx);
+        }
+        return value;
+    }
+
+    // FNV-1a with a final mix. Unlike std::hash it's the same in every process and
+    // build, which saved player filters and the nodes of a cluster rely on
+    inline uint64_t HashKey(const std::string& key)
+    {
+        uint64_t hash{ 0xCBF29CE484222325ull };
+        for (char keyChar : key)
+        {
+            hash ^= static_cast<unsigned char>(keyChar);
+            hash *= 0x100000001B3ull;
+        }
+        hash = (hash ^ (hash >> 30)) * 0xBF58476D1CE4E5B9ull;
+        hash = (hash ^ (hash >> 27)) * 0x94D049BB133111EBull;
+        return hash ^ (hash >> 31);
+    }
+
+    inline std::string EncodeRedirect(const std::string& host, unsigned short port)
+    {
+        return REDIRECT + host + ":" + std::to_string(port) + PUSH_DELTA_END;
+    }
+
+    // Reads a whole redirect frame, PUSH_DELTA_END included. False if the frame
+    // isn't one or the host or port are malformed
+    inline bool ParseRedirect(const std::string& frame, std::string& host, unsigned short& port)
+    {
+        if (frame.size() < 4 || frame[0] != REDIRECT || frame.find(PUSH_DELTA_END) != frame.size() - 1)
+        {
+            return false;
+        }
+
+        size_t portStart{ frame.rfind(':') };
+        if (portStart == std::string::npos || portStart < 2)
+        {
+            return false;
+        }
+        for (size_t hostIdx{ 1 }; hostIdx < portStart; ++hostIdx)
+        {
+            if (frame[hostIdx] <= ' ' || frame[hostIdx] > '~')
+            {
+                return false;
+            }
+        }
+
+        size_t portEnd{ frame.size() - 1 };
+        if (portEnd == portStart + 1 || portEnd - portStart - 1 > 5)
+        {
+            return false;
+        }
+        unsigned long portValue{ 0 };
+        for (size_t portIdx{ portStart + 1 }; portIdx < portEnd; ++portIdx)
+        {
+            if (frame[portIdx] < '0' || frame[portIdx] > '9')
+            {
+                return false;
+            }
+            portValue = portValue * 10 + static_cast<unsigned long>(frame[portIdx] - '0');
+        }
+        if (portValue == 0 || portValue > 65535)
+        {
+            return false;
+        }
+
+        host = frame.substr(1, portStart - 1);
+        port = static_cast<unsigned short>(portValue);
+        return true;
+    }
+
+    // Where the reply at the front of data ends, the position of its REPLY_END, or npos
+    // if some of it hasn't arrived yet. requestCode is the control code of the request
+    // being answered, VERSIONED_DELTA replies to VIEW_IF_NEWER are found by their length
+    inline size_t FindReplyEnd(const std::string& data, char requestCode)
+    {
+        if (requestCode == VIEW_IF_NEWER && !data.empty() && data[0] == VERSIONED_DELTA)
+        {
+            const size_t HEADER_SIZE{ 1 + VERSION_SIZE + 1 };
+            if (data.size() < HEADER_SIZE)
+            {
+                return std::string::npos;
+            }
+            const size_t fieldCount{ static_cast<unsigned char>(data[HEADER_SIZE - 1]) };
+            const size_t replyEnd{ HEADER_SIZE + fieldCount * (1 + DELTA_VALUE_SIZE) };
+            return data.size() > replyEnd ? replyEnd : std::string::npos;
+        }
+        return data.find(REPLY_END);
+    }
+
+    // Numbers from storage or the wire, false instead of throwing when the text isn't
+    // a whole number between minValue and maxValue
+    inline bool ParseInteger(const std::string& text, long long minValue, long long maxValue, long long& value)
+    {
+        if (text.empty())
+        {
+            return false;
+        }
+        char* textEnd{ nullptr };
+        errno = 0;
+        const long long parsed{ std::strtoll(text.c_str(), &textEnd, 10) };
+        if (*textEnd != '\0' || errno == ERANGE || parsed < minValue || parsed > maxValue)
+        {
+            return false;
+        }
+        value = parsed;
+        return true;
+    }
+
+    inline bool ParseUnsigned(const std::string& text, unsigned long long& value)
+    {
+        if (text.empty() || text[0] == '-')
+        {
+            return false;
+        }
+        char* textEnd{ nullptr };
+        errno = 0;
+        const unsigned long long parsed{ std::strtoull(text.c_str(), &textEnd, 10) };
+        if (*textEnd != '\0' || errno == ERANGE)
+        {
+            return false;
+        }
+        value = parsed;
+        return true;
+    }
 
     inline std::string GetPlayerIDForInt(int id)
     {
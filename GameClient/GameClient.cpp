@@ -9,12 +9,16 @@
 #undef IN
 #undef GetMessage
 
+// console keyboard checks
+#include <conio.h>
+
 #include <iostream>
 #include <iomanip>
+#include <map>
 #include <string>
 #include <sstream>
 
-#include "..\Common\common.h"
+#include "../Common/common.h"
 
 using namespace std;
 
@@ -22,22 +26,65 @@ const char SERVERADDR[] = "127.0.0.1";
 
 namespace AmazingRPG
 {
-
-    bool RunSocketClient()
+    // Waits up to timeoutMs for data from the server. Returns the number of bytes
+    // received, 0 on a timeout and -1 if the connection was closed or failed
+    int ReceiveFromServer(SOCKET connectSocket, char* recvBuffer, int timeoutMs)
     {
-        // first grab the player ID
-        std::string playerID = AskForPlayerID();
-        
-        cout << "Attempting to connect to server at " << SERVERADDR << ":" << PORT << endl;
+        fd_set readSet;
+        FD_ZERO(&readSet);
+        FD_SET(connectSocket, &readSet);
+        timeval timeout{ timeoutMs / 1000, (timeoutMs % 1000) * 1000 };
 
-        WSADATA wsaData;
-        int errorNum = WSAStartup(MAKEWORD(2, 2), &wsaData);
-        if (errorNum != 0)
+        int ready{ select(0, &readSet, nullptr, nullptr, &timeout) };
+        if (ready == SOCKET_ERROR)
         {
-            cout << "WSAStartup failed with error " << errorNum << endl;
-            return false;
+            cout << "Error waiting for data: " << WSAGetLastError() << endl;
+            return -1;
+        }
+        if (ready == 0)
+        {
+            return 0;
         }
 
+        int bytexfer{ recv(connectSocket, recvBuffer, static_cast<int>(SOCKET_BUFFER_SIZE), 0) };
+        if (bytexfer == 0)
+        {
+            cout << "Connection closed" << endl;
+            return -1;
+        }
+        if (bytexfer < 0)
+        {
+            cout << "Error receiving data: " << WSAGetLastError() << endl;
+            return -1;
+        }
+        return bytexfer;
+    }
+
+    // Waits up to timeoutMs for each part of the reply to a request with requestCode,
+    // the reply is put back together without its REPLY_END. Returns the number of bytes
+    // received, 0 on a timeout and -1 if the connection was closed or failed
+    int ReceiveReply(SOCKET connectSocket, char requestCode, int timeoutMs, string& reply)
+    {
+        char recvBuffer[SOCKET_BUFFER_SIZE];
+        string pending;
+        size_t replyEnd{ string::npos };
+        while (replyEnd == string::npos)
+        {
+            int bytexfer{ ReceiveFromServer(connectSocket, recvBuffer, timeoutMs) };
+            if (bytexfer <= 0)
+            {
+                return bytexfer;
+            }
+            pending.append(recvBuffer, bytexfer);
+            replyEnd = FindReplyEnd(pending, requestCode);
+        }
+        reply = pending.substr(0, replyEnd);
+        return static_cast<int>(pending.size());
+    }
+
+    // Returns INVALID_SOCKET if none of the server's addresses accept the connection
+    SOCKET ConnectToServer(const string& serverAddress, u_short port)
+    {
         addrinfo hints;
         ZeroMemory(&hints, sizeof(hints));
         hints.ai_family = AF_UNSPEC;
@@ -45,12 +92,11 @@ namespace AmazingRPG
         hints.ai_protocol = IPPROTO_TCP;
 
         addrinfo* addrResult = nullptr;
-        errorNum = getaddrinfo(SERVERADDR, to_string(PORT).c_str(), &hints, &addrResult);
+        int errorNum = getaddrinfo(serverAddress.c_str(), to_string(port).c_str(), &hints, &addrResult);
         if (errorNum != 0)
         {
             cout << "getaddrinfo failed with error " << errorNum << endl;
-            WSACleanup();
-            return false;
+            return INVALID_SOCKET;
         }
 
         SOCKET connectSocket = INVALID_SOCKET;
@@ -61,8 +107,7 @@ namespace AmazingRPG
             if (connectSocket == INVALID_SOCKET)
             {
                 cout << "Socket failed with error " << WSAGetLastError() << endl;
-                WSACleanup();
-                return false;
+                break;
             }
 
             errorNum = connect(connectSocket, curAddr->ai_addr, (int)curAddr->ai_addrlen);
@@ -80,10 +125,426 @@ namespace AmazingRPG
         if (connectSocket == INVALID_SOCKET)
         {
             cout << "Unable to connect with server" << endl;
+        }
+        return connectSocket;
+    }
+
+    // Follows a REDIRECT frame to the server that owns the player. The old
+    // connection is closed, connectSocket is INVALID_SOCKET if the move failed
+    bool FollowRedirect(SOCKET& connectSocket, const string& redirect)
+    {
+        string host;
+        u_short port{ 0 };
+        if (!ParseRedirect(redirect, host, port))
+        {
+            cout << "Badly formed redirect from server" << endl;
+            return false;
+        }
+
+        cout << "Player lives on another server, moving to " << host << ":" << port << endl;
+
+        closesocket(connectSocket);
+        connectSocket = ConnectToServer(host, port);
+        return connectSocket != INVALID_SOCKET;
+    }
+
+    void PrintPlayerDelta(const string& message)
+    {
+        cout << "Player " << message.substr(1, ID_SIZE) << " changed:";
+        size_t fieldStart{ 1 + static_cast<size_t>(ID_SIZE) };
+        while (fieldStart < message.size())
+        {
+            size_t fieldEnd{ message.find(PUSH_DELTA_FIELD_END, fieldStart) };
+            if (fieldEnd == string::npos)
+            {
+                break;
+            }
+
+            char fieldCode{ message[fieldStart] };
+            string value{ message.substr(fieldStart + 1, fieldEnd - fieldStart - 1) };
+            cout << (fieldCode == STR ? " strength " : fieldCode == INT ? " intellect " : " unknown ") << value;
+            fieldStart = fieldEnd + 1;
+        }
+        cout << endl;
+    }
+
+    // Subscribes to the player and prints the pushed changes until a key is pressed,
+    // no polling or VIEW requests needed while watching
+    bool WatchPlayer(SOCKET& connectSocket, const string& playerID)
+    {
+        string command{ SUBSCRIBE + playerID };
+        if (send(connectSocket, command.c_str(), static_cast<int>(command.length()), 0) == SOCKET_ERROR)
+        {
+            cout << "Send subscribe failed due to error " << WSAGetLastError() << endl;
+            return false;
+        }
+
+        cout << "Watching player " << playerID << ", press any key to stop" << endl;
+
+        char recvBuffer[SOCKET_BUFFER_SIZE];
+        string pending;
+        while (!_kbhit())
+        {
+            int bytexfer{ ReceiveFromServer(connectSocket, recvBuffer, 250) };
+            if (bytexfer < 0)
+            {
+                return false;
+            }
+            pending.append(recvBuffer, bytexfer);
+
+            // the first push is the reply to the subscribe, with the current stats
+            while (true)
+            {
+                if (!pending.empty() && pending[0] == REPLY_END)
+                {
+                    // the end of the subscribe reply, the pushes carry on after it
+                    pending.erase(0, 1);
+                }
+                size_t messageEnd{ pending.find(PUSH_DELTA_END) };
+                if (messageEnd == string::npos)
+                {
+                    break;
+                }
+
+                string message{ pending.substr(0, messageEnd) };
+                pending.erase(0, messageEnd + 1);
+                if (!message.empty() && message[0] == PUSH_DELTA)
+                {
+                    PrintPlayerDelta(message);
+                }
+                else if (message.size() == 1 && message[0] == KEEPALIVE)
+                {
+                    // the server checking we're still here, the receive was all it needed
+                }
+                else if (!message.empty() && message[0] == REDIRECT)
+                {
+                    // the player lives on another cluster node, subscribe there instead
+                    if (!FollowRedirect(connectSocket, message + PUSH_DELTA_END))
+                    {
+                        return false;
+                    }
+                    pending.clear();
+                    if (send(connectSocket, command.c_str(), static_cast<int>(command.length()), 0) == SOCKET_ERROR)
+                    {
+                        cout << "Send subscribe failed due to error " << WSAGetLastError() << endl;
+                        return false;
+                    }
+                }
+                else
+                {
+                    cout << "Server response: " << message << endl;
+                }
+            }
+
+            if (!pending.empty() && pending[0] != PUSH_DELTA && pending[0] != REDIRECT)
+            {
+                // not a push, so something like a "player not found" reply
+                size_t replyEnd{ pending.find(REPLY_END) };
+                if (replyEnd == string::npos)
+                {
+                    // wait for the rest of the reply
+                    continue;
+                }
+                cout << "Server response: " << pending.substr(0, replyEnd) << endl;
+                pending.clear();
+                break;
+            }
+        }
+        // eat the key press so it doesn't end up in the menu choice
+        while (_kbhit())
+        {
+            _getch();
+        }
+
+        command = UNSUBSCRIBE + playerID;
+        if (send(connectSocket, command.c_str(), static_cast<int>(command.length()), 0) == SOCKET_ERROR)
+        {
+            cout << "Send unsubscribe failed due to error " << WSAGetLastError() << endl;
+            return false;
+        }
+        return true;
+    }
+
+    void PrintInventoryItem(const string& message)
+    {
+        size_t countStart{ message.find(PUSH_DELTA_FIELD_END) };
+        size_t nameStart{ countStart == string::npos ? string::npos : message.find(PUSH_DELTA_FIELD_END, countStart + 1) };
+        if (nameStart == string::npos)
+        {
+            cout << "Badly formed inventory item: " << message << endl;
+            return;
+        }
+        cout << "\t" << message.substr(1, countStart - 1) << "\t" << message.substr(countStart + 1, nameStart - countStart - 1)
+             << " x " << message.substr(nameStart + 1) << endl;
+    }
+
+    // Stops a listing the client has given up on. Everything the server sends up to
+    // its cancel confirmation is left over from the listing and dropped, so none of
+    // it ends up in the reply to the next command. pending is what was already received
+    bool CancelInventoryListing(SOCKET connectSocket, const string& playerID, string pending, int timeoutMs)
+    {
+        string command{ INVENTORY + playerID + INVENTORY_CANCEL };
+        if (send(connectSocket, command.c_str(), static_cast<int>(command.length()), 0) == SOCKET_ERROR)
+        {
+            cout << "Send inventory cancel failed due to error " << WSAGetLastError() << endl;
+            return false;
+        }
+
+        const string CANCELLED{ INVENTORY_END, INVENTORY_CANCEL, PUSH_DELTA_END };
+        char recvBuffer[SOCKET_BUFFER_SIZE];
+        size_t searchStart{ 0 };
+        while (true)
+        {
+            size_t cancelledPos{ pending.find(CANCELLED, searchStart) };
+            while (cancelledPos != string::npos)
+            {
+                // the confirmation starts a line, unless it follows a text reply's REPLY_END.
+                // Only an item's name could end in the same characters
+                size_t lineStart{ cancelledPos == 0 ? string::npos : pending.rfind(PUSH_DELTA_END, cancelledPos - 1) };
+                lineStart = lineStart == string::npos ? 0 : lineStart + 1;
+                if (lineStart == cancelledPos || pending[lineStart] != INVENTORY_ITEM)
+                {
+                    return true;
+                }
+                cancelledPos = pending.find(CANCELLED, cancelledPos + 1);
+            }
+            // the confirmation can straddle two receives
+            searchStart = pending.size() < CANCELLED.size() ? 0 : pending.size() - CANCELLED.size();
+
+            int bytexfer{ ReceiveFromServer(connectSocket, recvBuffer, timeoutMs) };
+            if (bytexfer < 0)
+            {
+                return false;
+            }
+            if (bytexfer == 0)
+            {
+                cout << "Server didn't confirm the inventory listing stopped" << endl;
+                return true;
+            }
+            pending.append(recvBuffer, bytexfer);
+        }
+    }
+
+    // Lists the player's inventory as the server streams it, items are printed as
+    // they arrive so nothing builds up here however big the inventory is. After
+    // each batch of pages the user can ask for more with the continuation token
+    bool ListInventory(SOCKET& connectSocket, const string& playerID)
+    {
+        const int RESPONSE_TIMEOUT_MS{ 5000 };
+        string continuationToken;
+        int itemCount{ 0 };
+        while (true)
+        {
+            string command{ INVENTORY + playerID + continuationToken };
+            if (send(connectSocket, command.c_str(), static_cast<int>(command.length()), 0) == SOCKET_ERROR)
+            {
+                cout << "Send inventory request failed due to error " << WSAGetLastError() << endl;
+                return false;
+            }
+
+            char recvBuffer[SOCKET_BUFFER_SIZE];
+            string pending;
+            bool listingDone{ false };
+            while (!listingDone)
+            {
+                int bytexfer{ ReceiveFromServer(connectSocket, recvBuffer, RESPONSE_TIMEOUT_MS) };
+                if (bytexfer < 0)
+                {
+                    return false;
+                }
+                if (bytexfer == 0)
+                {
+                    cout << "No response from server" << endl;
+                    return CancelInventoryListing(connectSocket, playerID, pending, RESPONSE_TIMEOUT_MS);
+                }
+                pending.append(recvBuffer, bytexfer);
+
+                if (pending[0] == REDIRECT)
+                {
+                    size_t redirectEnd{ pending.find(PUSH_DELTA_END) };
+                    if (redirectEnd == string::npos)
+                    {
+                        // wait for the rest of the frame
+                        continue;
+                    }
+                    // the player lives on another cluster node, ask there instead
+                    if (!FollowRedirect(connectSocket, pending.substr(0, redirectEnd + 1)))
+                    {
+                        return false;
+                    }
+                    pending.clear();
+                    if (send(connectSocket, command.c_str(), static_cast<int>(command.length()), 0) == SOCKET_ERROR)
+                    {
+                        cout << "Send inventory request failed due to error " << WSAGetLastError() << endl;
+                        return false;
+                    }
+                    continue;
+                }
+
+                size_t messageEnd{ pending.find(PUSH_DELTA_END) };
+                while (messageEnd != string::npos && !listingDone)
+                {
+                    string message{ pending.substr(0, messageEnd) };
+                    pending.erase(0, messageEnd + 1);
+                    if (!message.empty() && message[0] == INVENTORY_ITEM)
+                    {
+                        PrintInventoryItem(message);
+                        ++itemCount;
+                    }
+                    else if (!message.empty() && message[0] == INVENTORY_END)
+                    {
+                        continuationToken = message.substr(1);
+                        listingDone = true;
+                    }
+                    else if (message.size() != 1 || message[0] != KEEPALIVE)
+                    {
+                        cout << "Server response: " << message << endl;
+                        return CancelInventoryListing(connectSocket, playerID, pending, RESPONSE_TIMEOUT_MS);
+                    }
+                    messageEnd = pending.find(PUSH_DELTA_END);
+                }
+
+                if (!listingDone && !pending.empty() && pending[0] != INVENTORY_ITEM && pending[0] != INVENTORY_END && pending[0] != KEEPALIVE)
+                {
+                    // not part of a listing, so something like a "player not found" reply
+                    size_t replyEnd{ pending.find(REPLY_END) };
+                    if (replyEnd == string::npos)
+                    {
+                        // wait for the rest of the reply
+                        continue;
+                    }
+                    cout << "Server response: " << pending.substr(0, replyEnd) << endl;
+                    return CancelInventoryListing(connectSocket, playerID, pending.substr(replyEnd + 1), RESPONSE_TIMEOUT_MS);
+                }
+            }
+
+            if (continuationToken.empty())
+            {
+                cout << itemCount << " items in the inventory" << endl;
+                return true;
+            }
+
+            cout << itemCount << " items so far, show more? (y/n) ";
+            char more{ 'n' };
+            cin >> more;
+            if (more != 'y' && more != 'Y')
+            {
+                return true;
+            }
+        }
+    }
+
+    // What the client knows about its player from VIEW_IF_NEWER replies
+    struct KnownPlayer
+    {
+        unsigned long long version{ 0 };
+        map<char, int> fields;
+    };
+
+    // Applies a NOT_MODIFIED or VERSIONED_DELTA reply, false if the reply is neither
+    bool ApplyVersionedReply(const string& reply, KnownPlayer& knownPlayer)
+    {
+        if (reply.size() == 1 && reply[0] == NOT_MODIFIED)
+        {
+            cout << "Player hasn't changed since version " << knownPlayer.version << endl;
+            return true;
+        }
+
+        const size_t HEADER_SIZE{ 1 + VERSION_SIZE + 1 };
+        if (reply.size() < HEADER_SIZE || reply[0] != VERSIONED_DELTA)
+        {
+            return false;
+        }
+        const size_t fieldCount{ static_cast<unsigned char>(reply[1 + VERSION_SIZE]) };
+        if (reply.size() != HEADER_SIZE + fieldCount * (1 + DELTA_VALUE_SIZE))
+        {
+            return false;
+        }
+
+        knownPlayer.version = ReadLittleEndian(reply.data() + 1, VERSION_SIZE);
+        cout << "Player is now at version " << knownPlayer.version << ", " << fieldCount << " field(s) changed (" << reply.size() << " bytes)" << endl;
+        for (size_t fieldIdx{ 0 }; fieldIdx < fieldCount; ++fieldIdx)
+        {
+            const char* field{ reply.data() + HEADER_SIZE + fieldIdx * (1 + DELTA_VALUE_SIZE) };
+            knownPlayer.fields[field[0]] = static_cast<int>(ReadLittleEndian(field + 1, DELTA_VALUE_SIZE));
+        }
+        for (const auto& field : knownPlayer.fields)
+        {
+            cout << "\t" << (field.first == STR ? "Strength" : "Intellect") << ": " << field.second << endl;
+        }
+        return true;
+    }
+
+    // Builds a request that gives every player in a party the same stat change
+    string AskForGrantCommand()
+    {
+        cout << "Grant to strength (1) or intellect (2)? ";
+        int attrChoice{ 0 };
+        cin >> attrChoice;
+        if (cin.fail() || (attrChoice != 1 && attrChoice != 2))
+        {
+            cin.clear();
+            cin.ignore(numeric_limits<streamsize>::max(), '\n');
+            cout << "That choice doesn't exist" << endl;
+            return {};
+        }
+
+        cout << "Amount to grant (can be negative): ";
+        int amount{ 0 };
+        cin >> amount;
+        if (cin.fail())
+        {
+            cin.clear();
+            cin.ignore(numeric_limits<streamsize>::max(), '\n');
+            cout << "You didn't enter an integer" << endl;
+            return {};
+        }
+
+        cout << "How many players are in the party (up to " << MAX_GRANT_PLAYERS << ")? ";
+        int playerCount{ 0 };
+        cin >> playerCount;
+        if (cin.fail() || playerCount <= 0 || playerCount > static_cast<int>(MAX_GRANT_PLAYERS))
+        {
+            cin.clear();
+            cin.ignore(numeric_limits<streamsize>::max(), '\n');
+            cout << "That isn't a valid party size" << endl;
+            return {};
+        }
+
+        string command{ GRANT };
+        command += (attrChoice == 1 ? STR : INT);
+        command += to_string(amount);
+        command += GRANT_AMOUNT_END;
+        for (int playerIdx{ 0 }; playerIdx < playerCount; ++playerIdx)
+        {
+            command += AskForPlayerID();
+        }
+        return command;
+    }
+
+    bool RunSocketClient()
+    {
+        // first grab the player ID
+        std::string playerID = AskForPlayerID();
+        
+        cout << "Attempting to connect to server at " << SERVERADDR << ":" << PORT << endl;
+
+        WSADATA wsaData;
+        int errorNum = WSAStartup(MAKEWORD(2, 2), &wsaData);
+        if (errorNum != 0)
+        {
+            cout << "WSAStartup failed with error " << errorNum << endl;
+            return false;
+        }
+
+        SOCKET connectSocket{ ConnectToServer(SERVERADDR, PORT) };
+        if (connectSocket == INVALID_SOCKET)
+        {
             WSACleanup();
             return false;
         }
 
+        KnownPlayer knownPlayer;
         bool running = true;
         while (running)
         {
@@ -91,6 +552,10 @@ namespace AmazingRPG
             cout << "\t1. View Player" << endl;
             cout << "\t2. Increase player strength" << endl;
             cout << "\t3. Increase player intellect" << endl;
+            cout << "\t4. Watch player for changes" << endl;
+            cout << "\t5. Grant a stat change to a party" << endl;
+            cout << "\t6. Refresh player (only fetches what changed)" << endl;
+            cout << "\t7. List player inventory" << endl;
             cout << "\t9. Quit" << endl;
             cout << endl << "Your choice? ";
 
@@ -113,6 +578,37 @@ namespace AmazingRPG
                 case 3:
                     command = INT;
                     break;
+                case 4:
+                    if (!WatchPlayer(connectSocket, playerID))
+                    {
+                        closesocket(connectSocket);
+                        WSACleanup();
+                        return false;
+                    }
+                    // the unsubscribe reply is picked up below like any other response
+                    command.clear();
+                    break;
+                case 5:
+                    command = AskForGrantCommand();
+                    if (command.empty())
+                    {
+                        continue;
+                    }
+                    break;
+                case 6:
+                    command = VIEW_IF_NEWER;
+                    break;
+                case 7:
+                    if (!ListInventory(connectSocket, playerID))
+                    {
+                        if (connectSocket != INVALID_SOCKET)
+                        {
+                            closesocket(connectSocket);
+                        }
+                        WSACleanup();
+                        return false;
+                    }
+                    continue;
                 case 9:
                     cout << "Shutting down socket and quitting" << endl;
                     running = false;
@@ -122,47 +618,72 @@ namespace AmazingRPG
                     continue;
             }
             
-            command += playerID;
-
-            // send key and wait for response
-            string accessToken;
-            int bytexfer{ send(connectSocket, command.c_str(), static_cast<int>(command.length()), 0) };
-            if (bytexfer == SOCKET_ERROR)
+            if (!command.empty() && command[0] != GRANT)
             {
-                cout << "Send access token failed due to error " << WSAGetLastError() << endl;
-                closesocket(connectSocket);
-                WSACleanup();
-                return false;
+                // grants already carry their own list of players
+                command += playerID;
+            }
+            if (!command.empty() && command[0] == VIEW_IF_NEWER)
+            {
+                AppendLittleEndian(command, knownPlayer.version, VERSION_SIZE);
             }
 
-            cout << "Token bytes sent: " << bytexfer << endl;
-
-            char recvBuffer[SOCKET_BUFFER_SIZE];
-
-            do
+            // in a cluster we might get sent on to the server that owns the player
+            const int MAX_REDIRECTS{ 3 };
+            for (int redirectCount{ 0 }; redirectCount <= MAX_REDIRECTS; ++redirectCount)
             {
-                bytexfer = recv(connectSocket, recvBuffer, SOCKET_BUFFER_SIZE, 0);
-                if (bytexfer > 0)
+                if (!command.empty())
                 {
-                    cout << "Bytes received: " << bytexfer << endl;
-                    cout.write(recvBuffer, bytexfer);
-                    cout << endl;
+                    // send key and wait for response
+                    int bytexfer{ send(connectSocket, command.c_str(), static_cast<int>(command.length()), 0) };
+                    if (bytexfer == SOCKET_ERROR)
+                    {
+                        cout << "Send access token failed due to error " << WSAGetLastError() << endl;
+                        closesocket(connectSocket);
+                        WSACleanup();
+                        return false;
+                    }
 
-                    std::string serverResponse{ recvBuffer, recvBuffer + bytexfer };
-                    cout << "Server response: " << serverResponse << endl;
-                    break;
+                    cout << "Token bytes sent: " << bytexfer << endl;
+                }
+
+                // block until the server answers rather than polling for it
+                const int RESPONSE_TIMEOUT_MS{ 5000 };
+                std::string serverResponse;
+                int bytexfer{ ReceiveReply(connectSocket, command.empty() ? '\0' : command[0], RESPONSE_TIMEOUT_MS, serverResponse) };
+                if (bytexfer < 0)
+                {
+                    closesocket(connectSocket);
+                    WSACleanup();
+                    return false;
                 }
                 else if (bytexfer == 0)
                 {
-                    cout << "Connection closed" << endl;
+                    cout << "No response from server" << endl;
+                    break;
                 }
-                else
+
+                if (!serverResponse.empty() && serverResponse[0] == REDIRECT && !command.empty())
                 {
-                    cout << "Error receiving data: " << WSAGetLastError() << endl;
+                    if (!FollowRedirect(connectSocket, serverResponse))
+                    {
+                        if (connectSocket != INVALID_SOCKET)
+                        {
+                            closesocket(connectSocket);
+                        }
+                        WSACleanup();
+                        return false;
+                    }
+                    continue;
                 }
 
-                Sleep(5);
-            } while (bytexfer > 0);
+                cout << "Bytes received: " << bytexfer << endl;
+                if (command.empty() || command[0] != VIEW_IF_NEWER || !ApplyVersionedReply(serverResponse, knownPlayer))
+                {
+                    cout << "Server response: " << serverResponse << endl;
+                }
+                break;
+            }
         }
 
         closesocket(connectSocket);
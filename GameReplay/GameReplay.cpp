@@ -0,0 +1,458 @@
+// select() can only watch 64 sockets by default on Windows, replays need a lot more
+#define FD_SETSIZE 1024
+
+// Sockets library
+#include <WinSock2.h>
+#include <WS2tcpip.h>
+// windows.h, which is included by WinSock2.h has some defines that
+// conflict with the AWS libraries and the standard C++ library
+// we don't require these defines, so we'll remove them
+#undef min
+#undef max
+#undef IN
+#undef GetMessage
+
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <map>
+#include <string>
+#include <sstream>
+#include <vector>
+
+#include "../Common/common.h"
+#include "../Common/TraceFormat.h"
+
+using namespace std;
+
+namespace AmazingRPG
+{
+    // give up on a response after this long and count the request as an error
+    const chrono::seconds RESPONSE_TIMEOUT{ 5 };
+    // after a timeout the late response is waited for this long more and thrown
+    // away, so it isn't taken for the response to the next frame
+    const chrono::seconds LATE_RESPONSE_DRAIN{ 5 };
+
+    enum class ReplayState
+    {
+        Idle,
+        AwaitingResponse,
+        DrainingLateResponse,
+    };
+
+    // one replayed client connection, frames go out in trace order with at most
+    // one request waiting on a response, the same as the game client
+    struct ReplayConnection
+    {
+        SOCKET socket{ INVALID_SOCKET };
+        deque<const TraceRecord*> frames;
+        ReplayState state{ ReplayState::Idle };
+        // control code of the last frame sent, inventory listings answer with several lines
+        char requestCode{ 0 };
+        chrono::steady_clock::time_point sendTime;
+        // when AwaitingResponse times out or DrainingLateResponse gives up
+        chrono::steady_clock::time_point waitDeadline;
+        // bytes received that don't make up a whole message yet
+        string pending;
+    };
+
+    struct ReplayReport
+    {
+        long long requests{ 0 };
+        long long errors{ 0 };
+        double durationSeconds{ 0.0 };
+        double requestsPerSecond{ 0.0 };
+        double p50Ms{ 0.0 };
+        double p90Ms{ 0.0 };
+        double p99Ms{ 0.0 };
+        double maxMs{ 0.0 };
+    };
+
+    double GetPercentile(vector<double>& samples, double percentile)
+    {
+        if (samples.empty())
+        {
+            return 0.0;
+        }
+        size_t index{ static_cast<size_t>(percentile / 100.0 * (samples.size() - 1)) };
+        nth_element(samples.begin(), samples.begin() + index, samples.end());
+        return samples[index];
+    }
+
+    SOCKET ConnectToServer(const string& serverAddress)
+    {
+        addrinfo hints;
+        ZeroMemory(&hints, sizeof(hints));
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        hints.ai_protocol = IPPROTO_TCP;
+
+        addrinfo* addrResult = nullptr;
+        if (getaddrinfo(serverAddress.c_str(), to_string(PORT).c_str(), &hints, &addrResult) != 0)
+        {
+            return INVALID_SOCKET;
+        }
+
+        SOCKET connectSocket{ INVALID_SOCKET };
+        for (addrinfo* curAddr = addrResult; curAddr != nullptr; curAddr = curAddr->ai_next)
+        {
+            connectSocket = socket(curAddr->ai_family, curAddr->ai_socktype, curAddr->ai_protocol);
+            if (connectSocket == INVALID_SOCKET)
+            {
+                continue;
+            }
+            if (connect(connectSocket, curAddr->ai_addr, static_cast<int>(curAddr->ai_addrlen)) == SOCKET_ERROR)
+            {
+                closesocket(connectSocket);
+                connectSocket = INVALID_SOCKET;
+                continue;
+            }
+            break;
+        }
+        freeaddrinfo(addrResult);
+        return connectSocket;
+    }
+
+    // A response has arrived for the connection's request. Responses that turn up
+    // when nothing is waiting are stray and dropped
+    void CompleteResponse(ReplayConnection& connection, chrono::steady_clock::time_point now, vector<double>& latenciesMs)
+    {
+        if (connection.state == ReplayState::AwaitingResponse)
+        {
+            latenciesMs.push_back(chrono::duration<double, milli>(now - connection.sendTime).count());
+        }
+        connection.state = ReplayState::Idle;
+    }
+
+    // Splits what the server sent into messages. Pushed deltas and keepalives end
+    // in PUSH_DELTA_END and never answer a request. An inventory listing is every
+    // line up to its INVENTORY_END. Any other reply runs up to its REPLY_END, which
+    // can be several receives away
+    void ConsumeServerData(ReplayConnection& connection, chrono::steady_clock::time_point now, vector<double>& latenciesMs)
+    {
+        string& pending{ connection.pending };
+        while (!pending.empty())
+        {
+            const char messageCode{ pending[0] };
+            const bool isPush{ messageCode == PUSH_DELTA || messageCode == KEEPALIVE };
+            const bool isInventoryLine{ connection.requestCode == INVENTORY && (messageCode == INVENTORY_ITEM || messageCode == INVENTORY_END) };
+            if (!isPush && !isInventoryLine)
+            {
+                size_t replyEnd{ FindReplyEnd(pending, connection.requestCode) };
+                if (replyEnd == string::npos)
+                {
+                    // wait for the rest of the reply
+                    return;
+                }
+                pending.erase(0, replyEnd + 1);
+                CompleteResponse(connection, now, latenciesMs);
+                continue;
+            }
+
+            size_t messageEnd{ pending.find(PUSH_DELTA_END) };
+            if (messageEnd == string::npos)
+            {
+                // wait for the rest of the line
+                return;
+            }
+            pending.erase(0, messageEnd + 1);
+            if (messageCode == INVENTORY_END)
+            {
+                CompleteResponse(connection, now, latenciesMs);
+            }
+        }
+    }
+
+    // Plays the trace against the server. speed scales the gaps between frames,
+    // 1 is real time, 2 twice as fast and 0 sends every frame as soon as its
+    // connection is free
+    bool ReplayTrace(const vector<TraceRecord>& records, const string& serverAddress, double speed, ReplayReport& report)
+    {
+        map<uint32_t, ReplayConnection> connections;
+        for (const TraceRecord& record : records)
+        {
+            connections[record.connectionID].frames.push_back(&record);
+        }
+
+        cout << "Opening " << connections.size() << " connections to " << serverAddress << endl;
+        for (auto& connection : connections)
+        {
+            connection.second.socket = ConnectToServer(serverAddress);
+            if (connection.second.socket == INVALID_SOCKET)
+            {
+                cout << "Unable to connect with server" << endl;
+                return false;
+            }
+        }
+
+        vector<double> latenciesMs;
+        latenciesMs.reserve(records.size());
+        char recvBuffer[SOCKET_BUFFER_SIZE];
+        const auto startTime{ chrono::steady_clock::now() };
+        size_t activeConnections{ connections.size() };
+
+        while (activeConnections > 0)
+        {
+            auto now{ chrono::steady_clock::now() };
+            double replayMicros{ chrono::duration<double, micro>(now - startTime).count() * speed };
+            // the next thing due, a frame or a response timing out, used to size the wait
+            auto nextWake{ now + chrono::seconds{ 1 } };
+
+            fd_set readSet;
+            FD_ZERO(&readSet);
+            activeConnections = 0;
+            for (auto& connectionEntry : connections)
+            {
+                ReplayConnection& connection{ connectionEntry.second };
+                if (connection.socket == INVALID_SOCKET)
+                {
+                    continue;
+                }
+
+                if (connection.state == ReplayState::AwaitingResponse && now >= connection.waitDeadline)
+                {
+                    ++report.errors;
+                    connection.state = ReplayState::DrainingLateResponse;
+                    connection.waitDeadline = now + LATE_RESPONSE_DRAIN;
+                }
+                else if (connection.state == ReplayState::DrainingLateResponse && now >= connection.waitDeadline)
+                {
+                    // it's never coming, anything that turns up later is dropped as stray
+                    connection.state = ReplayState::Idle;
+                }
+
+                if (connection.state == ReplayState::Idle && !connection.frames.empty())
+                {
+                    const TraceRecord& record{ *connection.frames.front() };
+                    if (speed <= 0.0 || record.timestampMicros <= replayMicros)
+                    {
+                        if (send(connection.socket, record.frame.data(), static_cast<int>(record.frame.size()), 0) == SOCKET_ERROR)
+                        {
+                            cout << "Send failed due to error " << WSAGetLastError() << endl;
+                            report.errors += static_cast<long long>(connection.frames.size());
+                            connection.frames.clear();
+                        }
+                        else
+                        {
+                            connection.frames.pop_front();
+                            connection.state = ReplayState::AwaitingResponse;
+                            connection.requestCode = record.frame.empty() ? 0 : record.frame[0];
+                            connection.sendTime = chrono::steady_clock::now();
+                            connection.waitDeadline = connection.sendTime + RESPONSE_TIMEOUT;
+                        }
+                    }
+                    else
+                    {
+                        auto dueIn{ chrono::microseconds{ static_cast<long long>((record.timestampMicros - replayMicros) / speed) } };
+                        nextWake = min(nextWake, now + dueIn);
+                    }
+                }
+
+                if (connection.state == ReplayState::Idle && connection.frames.empty())
+                {
+                    closesocket(connection.socket);
+                    connection.socket = INVALID_SOCKET;
+                    continue;
+                }
+
+                ++activeConnections;
+                // always read, so pushes and stray responses are drained before the next frame goes out
+                FD_SET(connection.socket, &readSet);
+                if (connection.state != ReplayState::Idle)
+                {
+                    nextWake = min(nextWake, connection.waitDeadline);
+                }
+            }
+
+            if (activeConnections == 0)
+            {
+                break;
+            }
+
+            // select waits with a real timeout, rounded up so it never spins on a sub-millisecond wait
+            auto waitMicros{ max<long long>(1000, chrono::duration_cast<chrono::microseconds>(nextWake - chrono::steady_clock::now()).count()) };
+            timeval timeout{ static_cast<long>(waitMicros / 1000000), static_cast<long>(waitMicros % 1000000) };
+            if (select(0, &readSet, nullptr, nullptr, &timeout) == SOCKET_ERROR)
+            {
+                cout << "select error " << WSAGetLastError() << endl;
+                return false;
+            }
+
+            now = chrono::steady_clock::now();
+            for (auto& connectionEntry : connections)
+            {
+                ReplayConnection& connection{ connectionEntry.second };
+                if (connection.socket == INVALID_SOCKET || !FD_ISSET(connection.socket, &readSet))
+                {
+                    continue;
+                }
+
+                int bytexfer{ recv(connection.socket, recvBuffer, SOCKET_BUFFER_SIZE, 0) };
+                if (bytexfer <= 0)
+                {
+                    report.errors += (connection.state == ReplayState::AwaitingResponse ? 1 : 0) + static_cast<long long>(connection.frames.size());
+                    connection.frames.clear();
+                    connection.state = ReplayState::Idle;
+                    closesocket(connection.socket);
+                    connection.socket = INVALID_SOCKET;
+                    continue;
+                }
+
+                connection.pending.append(recvBuffer, bytexfer);
+                ConsumeServerData(connection, now, latenciesMs);
+            }
+        }
+
+        report.durationSeconds = chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+        report.requests = static_cast<long long>(latenciesMs.size());
+        report.requestsPerSecond = report.requests / max(report.durationSeconds, 1e-9);
+        report.p50Ms = GetPercentile(latenciesMs, 50.0);
+        report.p90Ms = GetPercentile(latenciesMs, 90.0);
+        report.p99Ms = GetPercentile(latenciesMs, 99.0);
+        report.maxMs = latenciesMs.empty() ? 0.0 : *max_element(latenciesMs.begin(), latenciesMs.end());
+        return true;
+    }
+
+    // reports are saved as "name value" lines so a later run can compare against them
+    map<string, double> GetReportValues(const ReplayReport& report)
+    {
+        return {
+            { "requests", static_cast<double>(report.requests) },
+            { "errors", static_cast<double>(report.errors) },
+            { "duration_s", report.durationSeconds },
+            { "requests_per_s", report.requestsPerSecond },
+            { "p50_ms", report.p50Ms },
+            { "p90_ms", report.p90Ms },
+            { "p99_ms", report.p99Ms },
+            { "max_ms", report.maxMs },
+        };
+    }
+
+    bool SaveReport(const string& fileName, const ReplayReport& report)
+    {
+        ofstream reportFile{ fileName };
+        for (const auto& value : GetReportValues(report))
+        {
+            reportFile << value.first << " " << value.second << endl;
+        }
+        return static_cast<bool>(reportFile);
+    }
+
+    bool LoadReport(const string& fileName, map<string, double>& values)
+    {
+        ifstream reportFile{ fileName };
+        string name;
+        double value;
+        while (reportFile >> name >> value)
+        {
+            values[name] = value;
+        }
+        return !values.empty();
+    }
+
+    void PrintReport(const ReplayReport& report, const map<string, double>& baseline)
+    {
+        cout << endl << setw(16) << left << "Metric" << right << setw(14) << "This run";
+        if (!baseline.empty())
+        {
+            cout << setw(14) << "Baseline" << setw(10) << "Change";
+        }
+        cout << endl;
+
+        for (const auto& value : GetReportValues(report))
+        {
+            cout << setw(16) << left << value.first << right << setw(14) << value.second;
+            auto baselineValue{ baseline.find(value.first) };
+            if (baselineValue != baseline.end())
+            {
+                cout << setw(14) << baselineValue->second;
+                if (baselineValue->second != 0.0)
+                {
+                    double change{ 100.0 * (value.second - baselineValue->second) / baselineValue->second };
+                    cout << setw(9) << fixed << setprecision(1) << showpos << change << "%" << noshowpos;
+                    cout.unsetf(ios_base::floatfield);
+                    cout << setprecision(6);
+                }
+            }
+            cout << endl;
+        }
+    }
+
+    bool RunReplay()
+    {
+        cout << "Trace file to replay: ";
+        string traceFileName;
+        cin >> traceFileName;
+
+        TraceReader traceReader;
+        if (!traceReader.Open(traceFileName))
+        {
+            cout << "Unable to read trace " << traceFileName << endl;
+            return false;
+        }
+        vector<TraceRecord> records;
+        TraceRecord record;
+        while (traceReader.Read(record))
+        {
+            records.push_back(record);
+        }
+        cout << "Loaded " << records.size() << " frames" << endl;
+
+        cout << "Server address: ";
+        string serverAddress;
+        cin >> serverAddress;
+
+        cout << "Replay speed (1 for real time, N for N times faster, 0 for as fast as possible): ";
+        double speed{ 1.0 };
+        cin >> speed;
+        if (cin.fail() || speed < 0.0)
+        {
+            cout << "That isn't a valid speed" << endl;
+            return false;
+        }
+
+        cout << "Baseline report to compare against (- for none): ";
+        string baselineFileName;
+        cin >> baselineFileName;
+        map<string, double> baseline;
+        if (baselineFileName != "-" && !LoadReport(baselineFileName, baseline))
+        {
+            cout << "Unable to read baseline report " << baselineFileName << endl;
+        }
+
+        cout << "File to save this run's report to (- for none): ";
+        string reportFileName;
+        cin >> reportFileName;
+
+        WSADATA wsaData;
+        int errorNum = WSAStartup(MAKEWORD(2, 2), &wsaData);
+        if (errorNum != 0)
+        {
+            cout << "WSAStartup failed with error " << errorNum << endl;
+            return false;
+        }
+
+        ReplayReport report;
+        bool replayed{ ReplayTrace(records, serverAddress, speed, report) };
+        WSACleanup();
+        if (!replayed)
+        {
+            return false;
+        }
+
+        PrintReport(report, baseline);
+        if (reportFileName != "-" && !SaveReport(reportFileName, report))
+        {
+            cout << "Unable to save report to " << reportFileName << endl;
+        }
+        return true;
+    }
+}
+
+int main()
+{
+    return AmazingRPG::RunReplay() ? 0 : 1;
+}
@@ -0,0 +1,127 @@
+#pragma once
+// Standard library
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Project includes
+#include "../Common/common.h"
+
+namespace AmazingRPG
+{
+    //////////////////////////////////////////////////////////////////////////////
+    // One game server in a cluster
+    struct ClusterNode
+    {
+        std::string name;
+        std::string host;
+        unsigned short port{ 0 };
+    };
+
+    //////////////////////////////////////////////////////////////////////////////
+    // Consistent hash ring that decides which node owns a player ID. Every node is
+    // placed on the ring many times (virtual nodes) so players spread evenly, and
+    // adding or removing a node only moves the players next to its points
+    class ConsistentHashRing
+    {
+    public:
+        explicit ConsistentHashRing(int virtualNodesPerNode)
+            : m_virtualNodesPerNode{ virtualNodesPerNode }
+        {
+        }
+
+        void SetNodes(const std::vector<ClusterNode>& nodes)
+        {
+            m_nodes = nodes;
+            m_ring.clear();
+            m_ring.reserve(m_nodes.size() * m_virtualNodesPerNode);
+            for (size_t nodeIdx{ 0 }; nodeIdx < m_nodes.size(); ++nodeIdx)
+            {
+                for (int virtualIdx{ 0 }; virtualIdx < m_virtualNodesPerNode; ++virtualIdx)
+                {
+                    m_ring.emplace_back(HashKey(m_nodes[nodeIdx].name + "#" + std::to_string(virtualIdx)), nodeIdx);
+                }
+            }
+            std::sort(m_ring.begin(), m_ring.end());
+        }
+
+        // the first point clockwise from the ID's hash owns it, nullptr if the ring is empty
+        const ClusterNode* GetOwner(const std::string& playerID) const
+        {
+            if (m_ring.empty())
+            {
+                return nullptr;
+            }
+
+            std::pair<uint64_t, size_t> key{ HashKey(playerID), 0 };
+            auto point{ std::lower_bound(m_ring.begin(), m_ring.end(), key) };
+            if (point == m_ring.end())
+            {
+                point = m_ring.begin();
+            }
+            return &m_nodes[point->second];
+        }
+
+        const ClusterNode* FindNode(const std::string& name) const
+        {
+            auto node{ std::find_if(m_nodes.begin(), m_nodes.end(), [&name](const ClusterNode& node) { return node.name == name; }) };
+            return node == m_nodes.end() ? nullptr : &*node;
+        }
+
+        const std::vector<ClusterNode>& GetNodes() const { return m_nodes; }
+
+    private:
+        int m_virtualNodesPerNode;
+        std::vector<ClusterNode> m_nodes;
+        // (point on the ring, index into m_nodes), sorted by point
+        std::vector<std::pair<uint64_t, size_t>> m_ring;
+    };
+
+    //////////////////////////////////////////////////////////////////////////////
+    // Reads the cluster membership, one node per line as "name host port".
+    // Blank lines and lines starting with # are skipped
+    inline bool LoadClusterConfig(const std::string& fileName, std::vector<ClusterNode>& nodes, std::string& error)
+    {
+        std::ifstream configFile{ fileName };
+        if (!configFile)
+        {
+            error = "Unable to open cluster config " + fileName;
+            return false;
+        }
+
+        nodes.clear();
+        std::string line;
+        int lineNumber{ 0 };
+        while (std::getline(configFile, line))
+        {
+            ++lineNumber;
+            size_t firstChar{ line.find_first_not_of(" \t\r") };
+            if (firstChar == std::string::npos || line[firstChar] == '#')
+            {
+                continue;
+            }
+
+            std::istringstream lineStream{ line };
+            ClusterNode node;
+            int port{ 0 };
+            if (!(lineStream >> node.name >> node.host >> port) || port <= 0 || port > 65535)
+            {
+                error = "Cluster config line " + std::to_string(lineNumber) + " should be \"name host port\"";
+                return false;
+            }
+            node.port = static_cast<unsigned short>(port);
+            nodes.push_back(node);
+        }
+
+        if (nodes.empty())
+        {
+            error = "Cluster config " + fileName + " has no nodes";
+            return false;
+        }
+        return true;
+    }
+}
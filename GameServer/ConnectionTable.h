@@ -0,0 +1,80 @@
+#pragma once
+// Standard library
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Project includes
+#include "../Common/common.h"
+#include "TimerWheel.h"
+
+namespace AmazingRPG
+{
+    //////////////////////////////////////////////////////////////////////////////
+    // Where a connection's inventory listing has got to, only the position is kept
+    // so memory doesn't grow with the size of the inventory
+    struct InventoryCursor
+    {
+        std::string playerID;
+        // the last item sent, empty before the first page
+        std::string lastItemID;
+        // pages still to send for this request, 0 when there's no listing
+        int pagesLeft{ 0 };
+    };
+
+    //////////////////////////////////////////////////////////////////////////////
+    // Everything the server keeps per connection apart from the Windows socket
+    // types, which SocketInformation adds. Socket is SOCKET on the server and a
+    // plain int in the benchmarks, so both measure the same table
+    template <typename Socket>
+    struct Connection
+    {
+        Socket socket{};
+        // identifies the connection in traffic traces
+        uint32_t connectionID{ 0 };
+        char writeBuffer[SOCKET_BUFFER_SIZE];
+        int bytesSEND{ 0 };
+        char readBuffer[SOCKET_BUFFER_SIZE];
+        int bytesRECV{ 0 };
+        // set when a request arrives, every DynamoDB call made for it has to finish by then
+        std::chrono::steady_clock::time_point requestDeadline{};
+        // pushed messages are shared between every subscriber, they go out after writeBuffer
+        // unless one is already partly sent, which is finished first
+        std::deque<std::shared_ptr<const std::string>> pushQueue;
+        size_t pushOffset{ 0 };
+        std::vector<std::string> subscribedPlayers;
+        InventoryCursor inventoryCursor;
+        // closes the connection when the client goes quiet
+        TimerID idleTimer{ INVALID_TIMER };
+        // closes the connection when the client stops taking its replies
+        TimerID sendTimer{ INVALID_TIMER };
+        // pings subscribers, who are quiet while they watch
+        TimerID keepaliveTimer{ INVALID_TIMER };
+    };
+
+    //////////////////////////////////////////////////////////////////////////////
+    // The server keeps its connections in a plain vector, these work on any
+    // connection type with a socket member so they can be benchmarked off Windows
+
+    // Removes every connection in socketsToFree from socketList in a single pass
+    template <typename SocketInfo>
+    void RemoveConnections(std::vector<SocketInfo>& socketList, const std::vector<SocketInfo>& socketsToFree)
+    {
+        if (socketsToFree.empty())
+        {
+            return;
+        }
+
+        socketList.erase(std::remove_if(socketList.begin(), socketList.end(), [&socketsToFree](const SocketInfo& info)
+        {
+            return std::any_of(socketsToFree.begin(), socketsToFree.end(), [&info](const SocketInfo& socketToFree)
+            {
+                return socketToFree.socket == info.socket;
+            });
+        }), socketList.end());
+    }
+}
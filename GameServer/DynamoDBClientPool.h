@@ -0,0 +1,100 @@
+#pragma once
+// Standard library
+#include <memory>
+#include <string>
+#include <vector>
+
+// AWS C++ SDK
+#include <aws/core/client/ClientConfiguration.h>
+#include <aws/core/utils/memory/AWSMemory.h>
+#include <aws/core/utils/threading/Executor.h>
+#include <aws/dynamodb/DynamoDBClient.h>
+
+// Project includes
+#include "Settings.h"
+
+namespace AmazingRPG
+{
+    //////////////////////////////////////////////////////////////////////////////
+    // Everything we tune on the DynamoDB HTTP transport, defaults come from Settings.h
+    struct DynamoDBClientSettings
+    {
+        std::string region{ REGION };
+        // empty uses the regional endpoint
+        std::string endpointOverride{ DYNAMODB_ENDPOINT_OVERRIDE };
+        // per client, so per worker clients open clientCount * maxConnections connections
+        unsigned maxConnections{ DYNAMODB_MAX_CONNECTIONS };
+        long connectTimeoutMs{ DYNAMODB_CONNECT_TIMEOUT_MS };
+        long requestTimeoutMs{ DYNAMODB_REQUEST_TIMEOUT_MS };
+        bool enableTcpKeepAlive{ DYNAMODB_TCP_KEEP_ALIVE };
+        unsigned long tcpKeepAliveIntervalMs{ DYNAMODB_TCP_KEEP_ALIVE_INTERVAL_MS };
+        // 0 keeps the SDK default executor, which starts a thread per async call
+        size_t executorThreads{ DYNAMODB_EXECUTOR_THREADS };
+        size_t clientCount{ DYNAMODB_CLIENT_COUNT };
+    };
+
+    //////////////////////////////////////////////////////////////////////////////
+    // Owns the DynamoDB clients. With one client every caller shares its connection
+    // pool, with more each worker index maps onto its own client and connections.
+    // All clients share one executor so async calls have a bounded thread count
+    class DynamoDBClientPool
+    {
+    public:
+        explicit DynamoDBClientPool(const DynamoDBClientSettings& settings)
+            : m_settings{ settings }
+        {
+            if (m_settings.executorThreads > 0)
+            {
+                m_executor = Aws::MakeShared<Aws::Utils::Threading::PooledThreadExecutor>(ALLOCATION_TAG, m_settings.executorThreads);
+            }
+
+            const size_t clientCount{ m_settings.clientCount > 0 ? m_settings.clientCount : 1 };
+            const Aws::Client::ClientConfiguration clientConfig{ MakeClientConfiguration(m_settings, m_executor) };
+            for (size_t clientIdx{ 0 }; clientIdx < clientCount; ++clientIdx)
+            {
+                m_clients.push_back(Aws::MakeShared<Aws::DynamoDB::DynamoDBClient>(ALLOCATION_TAG, clientConfig));
+            }
+        }
+
+        static Aws::Client::ClientConfiguration MakeClientConfiguration(const DynamoDBClientSettings& settings,
+            const std::shared_ptr<Aws::Utils::Threading::Executor>& executor)
+        {
+            Aws::Client::ClientConfiguration clientConfig;
+            clientConfig.region = settings.region;
+            if (!settings.endpointOverride.empty())
+            {
+                clientConfig.endpointOverride = settings.endpointOverride;
+                // DynamoDB Local only talks plain http
+                if (settings.endpointOverride.compare(0, 7, "http://") == 0)
+                {
+                    clientConfig.scheme = Aws::Http::Scheme::HTTP;
+                }
+            }
+            clientConfig.maxConnections = settings.maxConnections;
+            clientConfig.connectTimeoutMs = settings.connectTimeoutMs;
+            clientConfig.requestTimeoutMs = settings.requestTimeoutMs;
+            clientConfig.enableTcpKeepAlive = settings.enableTcpKeepAlive;
+            clientConfig.tcpKeepAliveIntervalMs = settings.tcpKeepAliveIntervalMs;
+            if (executor)
+            {
+                clientConfig.executor = executor;
+            }
+            return clientConfig;
+        }
+
+        const std::shared_ptr<Aws::DynamoDB::DynamoDBClient>& GetClient(size_t workerIndex = 0) const
+        {
+            return m_clients[workerIndex % m_clients.size()];
+        }
+
+        size_t GetClientCount() const { return m_clients.size(); }
+        const DynamoDBClientSettings& GetSettings() const { return m_settings; }
+
+    private:
+        static constexpr const char* ALLOCATION_TAG{ "DynamoDBClientPool" };
+
+        DynamoDBClientSettings m_settings;
+        std::shared_ptr<Aws::Utils::Threading::Executor> m_executor;
+        std::vector<std::shared_ptr<Aws::DynamoDB::DynamoDBClient>> m_clients;
+    };
+}
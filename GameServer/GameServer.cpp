@@ -15,7 +15,16 @@
 #include <thread>
 #include <random>
 #include <cmath>
+#include <climits>
 #include <list>
+#include <deque>
+#include <map>
+#include <unordered_map>
+#include <chrono>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <future>
 
 // AWS C++ SDK
 #include <aws/core/Aws.h>
@@ -37,80 +46,307 @@
 
 // Project includes
 #include "Settings.h"
-#include "..\Common\common.h"
+#include "../Common/common.h"
+#include "../Common/TraceFormat.h"
+#include "ClusterRing.h"
+#include "ConnectionTable.h"
+#include "DynamoDBClientPool.h"
+#include "HedgedRead.h"
+#include "HotKeys.h"
+#include "InMemoryPlayerStore.h"
+#include "InventoryTable.h"
+#include "PlayerFilter.h"
+#include "PlayerGenerator.h"
+#include "PlayerProtocol.h"
+#include "PlayerTable.h"
+#include "PlayerVersions.h"
+#include "TimerWheel.h"
 
 using namespace std;
 
 namespace AmazingRPG
 {
     //////////////////////////////////////////////////////////////////////////////
-    // Store socket info
-    struct SocketInformation {
+    // Store socket info, the portable part lives in Connection so the benchmarks use the same layout
+    struct SocketInformation : Connection<SOCKET> {
+        SocketInformation()
+        {
+            socket = INVALID_SOCKET;
+        }
+
         WSABUF dataBuffer{};
-        SOCKET socket{INVALID_SOCKET};
         OVERLAPPED overlapped{};
-        char writeBuffer[SOCKET_BUFFER_SIZE];
-        int bytesSEND{ 0 };
-        char readBuffer[SOCKET_BUFFER_SIZE];
-        int bytesRECV{ 0 };
     };
 
+    //////////////////////////////////////////////////////////////////////////////
+    // Subscription statics
+    // subscribers per player ID
+    static unordered_map<string, vector<SOCKET>> s_subscriptions;
+    // stat changes made this tick, keyed by player ID then field code, sent once per tick
+    static map<string, map<char, int>> s_pendingDeltas;
+
     //////////////////////////////////////////////////////////////////////////////
     // AWS client statics
+    static unique_ptr<DynamoDBClientPool> s_DynamoDBClientPool;
+    // the client used by the main thread, the first client in the pool
     static shared_ptr<Aws::DynamoDB::DynamoDBClient> s_DynamoDBClient;
-    const size_t MAX_DYNAMODB_BATCH_ITEMS{ 25 };
+    // inventory page reads get their own client and executor, a big listing never
+    // holds up player reads or their hedges waiting for an executor thread
+    static unique_ptr<DynamoDBClientPool> s_inventoryClientPool;
+    static shared_ptr<Aws::DynamoDB::DynamoDBClient> s_inventoryClient;
+
+    DynamoDBClientSettings MakeInventoryClientSettings()
+    {
+        DynamoDBClientSettings settings;
+        settings.maxConnections = static_cast<unsigned>(INVENTORY_MAX_QUERIES_IN_FLIGHT);
+        settings.executorThreads = INVENTORY_MAX_QUERIES_IN_FLIGHT;
+        settings.clientCount = 1;
+        return settings;
+    }
 
     //////////////////////////////////////////////////////////////////////////////
-    // Game specific statics and constants
-    static random_device s_randomDevice{};
-    static mt19937 s_randomGenerator{ s_randomDevice() };
-	static uniform_int_distribution<> s_levelDistribution{1, 60};
-    // our population will be decidedly normal, with some outliers
-    // (min and max are 3 standard deviations from average)
-    const double MIN_ATTR{ 3.0 };
-    const double MAX_ATTR{ 18.0f };
-    static normal_distribution<> s_attributeDistribution{ (MAX_ATTR + MIN_ATTR) / 2.0f, (MAX_ATTR - MIN_ATTR) / 6.0f };
+    // Hedged read statics
+    static LatencyTracker s_readLatency;
+    static HedgeBudget s_hedgeBudget{ HEDGE_BUDGET_RATIO, HEDGE_BUDGET_BURST };
+    static HedgeStats s_hedgeStats;
+
+    //////////////////////////////////////////////////////////////////////////////
+    // Hot key statics
+    static HotKeyDetector s_hotKeys{ HOT_KEY_SKETCH_WIDTH, HOT_KEY_SKETCH_DEPTH, HOT_KEY_TOP_COUNT, HOT_KEY_THRESHOLD, HOT_KEY_DECAY_INTERVAL };
+    static HotPlayerCache s_hotPlayers{ chrono::milliseconds{ HOT_KEY_PIN_MS } };
+    static HotKeyStats s_hotKeyStats;
+
+    //////////////////////////////////////////////////////////////////////////////
+    // Versioned read statics
+    static PlayerVersionTracker s_playerVersions{ MAX_TRACKED_PLAYER_VERSIONS };
+
+    //////////////////////////////////////////////////////////////////////////////
+    // Missing player filter statics
+    static PlayerExistenceFilter s_playerFilter{ PLAYER_FILTER_MAX_BITMAP_ID, PLAYER_FILTER_EXPECTED_PLAYERS, PLAYER_FILTER_FALSE_POSITIVE_RATE };
+    // off until the filter is built or loaded, an empty filter would turn every player away
+    static bool s_usePlayerFilter{ false };
+    static atomic<long long> s_playerFilterRejections{ 0 };
 
     //////////////////////////////////////////////////////////////////////////////
-    // data keys
-    // When naming your keys, be careful of reserved words https://docs.aws.amazon.com/amazondynamodb/latest/developerguide/ReservedWords.html
-    const string PLAYER_DATA_TABLE_NAME{ "PlayerData" };
-    const string DATA_KEY_ID{ "PlayerID" };
-    const string DATA_KEY_LEVEL{ "PlayerLevel" };
-    const string DATA_KEY_STRENGTH{ "PlayerStrength" };
-    const string DATA_KEY_INTELLECT{ "PlayerIntellect" };
+    // Inventory statics
+    // a page read started for a connection's listing, checked on every server loop tick
+    struct InventoryPageQuery
+    {
+        Deadline deadline;
+        Aws::DynamoDB::Model::QueryOutcomeCallable outcome;
+    };
+    // keyed by connectionID, sockets can be reused once a connection closes
+    static unordered_map<uint32_t, InventoryPageQuery> s_inventoryQueries;
+
+    //////////////////////////////////////////////////////////////////////////////
+    // Replay statics
+    // set while the socket server records its inbound traffic
+    static TraceWriter s_traceWriter;
+    // when set, player data lives in s_inMemoryPlayers instead of DynamoDB
+    static bool s_useInMemoryStorage{ false };
+    static InMemoryPlayerStore s_inMemoryPlayers;
+    // fixed so every replay run against in-memory storage starts from the same players
+    const uint64_t IN_MEMORY_PLAYER_SEED{ 1 };
+
+    //////////////////////////////////////////////////////////////////////////////
+    // Cluster statics
+    static ConsistentHashRing s_clusterRing{ CLUSTER_VIRTUAL_NODES };
+    // the node this server runs as, null when it isn't part of a cluster and owns every player
+    static const ClusterNode* s_localNode{ nullptr };
+    static atomic<long long> s_ownedRequests{ 0 };
+    static atomic<long long> s_redirectedRequests{ 0 };
+
+    //////////////////////////////////////////////////////////////////////////////
+    // Game specific statics and constants
+    static random_device s_randomDevice{};
 
     //////////////////////////////////////////////////////////////////////////////
     // Game code
-    int GenerateRandomStat()
+    PlayerGeneratorSettings MakeRandomPlayerGeneratorSettings()
     {
-        // since it's a normal distribution we don't want to clamp, we want
-        // to actually discard values that lie outside of our max and min
-        // otherwise there could be extra values at max and min
-        while (true)
+        PlayerGeneratorSettings settings;
+        settings.seed = (static_cast<uint64_t>(s_randomDevice()) << 32) | s_randomDevice();
+        return settings;
+    }
+
+    Deadline MakeDeadline()
+    {
+        return chrono::steady_clock::now() + chrono::milliseconds{ REQUEST_DEADLINE_MS };
+    }
+
+    // Shared between a query and its hedge, whichever answers first wins
+    struct HedgedQueryState
+    {
+        mutex resultMutex;
+        condition_variable resultReady;
+        int pendingQueries{ 1 };
+        bool hasResult{ false };
+        bool hedgeWon{ false };
+        Aws::DynamoDB::Model::QueryOutcome outcome;
+    };
+
+    void StartQuery(const Aws::DynamoDB::Model::QueryRequest& queryRequest, const shared_ptr<HedgedQueryState>& state, bool isHedge)
+    {
+        auto startTime{ chrono::steady_clock::now() };
+        s_DynamoDBClient->QueryAsync(queryRequest, [state, isHedge, startTime](const Aws::DynamoDB::DynamoDBClient*,
+            const Aws::DynamoDB::Model::QueryRequest&, const Aws::DynamoDB::Model::QueryOutcome& outcome,
+            const shared_ptr<const Aws::Client::AsyncCallerContext>&)
+        {
+            // losers still count, they are part of the latency we're hedging against
+            s_readLatency.Record(chrono::steady_clock::now() - startTime);
+
+            lock_guard<mutex> lock{ state->resultMutex };
+            --state->pendingQueries;
+            // an error only wins if there's nothing else left that could succeed
+            if (!state->hasResult && (outcome.IsSuccess() || state->pendingQueries == 0))
+            {
+                state->outcome = outcome;
+                state->hasResult = true;
+                state->hedgeWon = isHedge;
+                state->resultReady.notify_all();
+            }
+        });
+    }
+
+    // Sends the query and, if it hasn't come back by the recent p95 latency, sends it
+    // again and takes whichever answer arrives first. Returns false if neither
+    // answered before the deadline, the SDK finishes the stragglers in the background
+    bool HedgedQuery(const Aws::DynamoDB::Model::QueryRequest& queryRequest, Deadline deadline, Aws::DynamoDB::Model::QueryOutcome& outcome)
+    {
+        ++s_hedgeStats.reads;
+        s_hedgeBudget.OnRead();
+
+        auto state{ make_shared<HedgedQueryState>() };
+        StartQuery(queryRequest, state, false);
+
+        auto hedgeDelay{ s_readLatency.GetPercentile(HEDGE_PERCENTILE, chrono::milliseconds{ HEDGE_DEFAULT_DELAY_MS }) };
+        auto hedgeTime{ min(chrono::steady_clock::now() + chrono::duration_cast<chrono::steady_clock::duration>(hedgeDelay), deadline) };
+        auto hasResult = [&state] { return state->hasResult; };
+
+        unique_lock<mutex> lock{ state->resultMutex };
+        if (!state->resultReady.wait_until(lock, hedgeTime, hasResult))
         {
-            double testAttr{ s_attributeDistribution(s_randomGenerator) };
-            if (testAttr >= MIN_ATTR && testAttr <= MAX_ATTR)
+            if (hedgeTime < deadline)
+            {
+                if (s_hedgeBudget.TrySpend())
+                {
+                    ++state->pendingQueries;
+                    lock.unlock();
+                    StartQuery(queryRequest, state, true);
+                    ++s_hedgeStats.hedgesSent;
+                    lock.lock();
+                }
+                else
+                {
+                    ++s_hedgeStats.hedgesDenied;
+                }
+            }
+
+            if (!state->resultReady.wait_until(lock, deadline, hasResult))
             {
-                return lround(testAttr);
+                ++s_hedgeStats.deadlineMisses;
+                return false;
             }
         }
+
+        if (state->hedgeWon)
+        {
+            ++s_hedgeStats.hedgeWins;
+        }
+        outcome = state->outcome;
+        return true;
     }
 
-    bool GetPlayerDesc(const string& ID, PlayerDesc& playerDesc)
+    void ReportHedgeStats()
+    {
+        long long reads{ s_hedgeStats.reads };
+        long long hedgesSent{ s_hedgeStats.hedgesSent };
+        long long hedgeWins{ s_hedgeStats.hedgeWins };
+        cout << "Hedged reads: " << reads << " reads, "
+             << hedgesSent << " hedged (" << (reads > 0 ? 100.0 * hedgesSent / reads : 0.0) << "%), "
+             << hedgeWins << " hedge wins (" << (hedgesSent > 0 ? 100.0 * hedgeWins / hedgesSent : 0.0) << "%), "
+             << s_hedgeStats.hedgesDenied << " over budget, "
+             << s_hedgeStats.deadlineMisses << " missed deadline, "
+             << "hedge delay " << s_readLatency.GetPercentile(HEDGE_PERCENTILE, chrono::milliseconds{ HEDGE_DEFAULT_DELAY_MS }).count() << "ms" << endl;
+    }
+
+    void ReportHotKeyStats()
+    {
+        cout << "Hot keys: " << s_hotKeyStats.requests << " requests tracked, "
+             << s_hotKeyStats.pinnedHits << " served from pinned players, "
+             << s_hotKeyStats.backendReads << " read from DynamoDB, "
+             << s_hotPlayers.GetPinnedCount() << " players pinned" << endl;
+        for (const HotKey& hotKey : s_hotKeys.GetHotKeys())
+        {
+            cout << "\t" << hotKey.key << " ~" << hotKey.count << " recent requests" << endl;
+        }
+    }
+
+    void ReportPlayerFilterStats()
+    {
+        if (!s_usePlayerFilter)
+        {
+            return;
+        }
+        cout << "Missing player filter: " << s_playerFilterRejections << " requests for unknown players turned away, "
+             << s_playerFilter.GetPlayerCount() << " players known in " << s_playerFilter.GetMemoryBytes() / 1024 << "KB" << endl;
+    }
+
+    // false when the player definitely doesn't exist, so there's no point asking DynamoDB
+    bool PlayerMightExist(const string& ID)
+    {
+        if (!s_usePlayerFilter || s_playerFilter.MightExist(ID))
+        {
+            return true;
+        }
+        ++s_playerFilterRejections;
+        return false;
+    }
+
+    // Reads every player ID in the table, a page at a time. Players added by other
+    // servers or tools after this are unknown here until the filter is built again.
+    // The filter in use is only replaced once every page has been read
+    bool BuildPlayerFilterFromScan()
+    {
+        PlayerExistenceFilter playerFilter{ PLAYER_FILTER_MAX_BITMAP_ID, PLAYER_FILTER_EXPECTED_PLAYERS, PLAYER_FILTER_FALSE_POSITIVE_RATE };
+        map<string, Aws::DynamoDB::Model::AttributeValue> lastEvaluatedKey;
+        do
+        {
+            auto outcome{ s_DynamoDBClient->Scan(MakePlayerIDScanRequest(lastEvaluatedKey)) };
+            if (!outcome.IsSuccess())
+            {
+                cout << "Error scanning DynamoDB: " << outcome.GetError() << endl;
+                return false;
+            }
+
+            const auto& result{ outcome.GetResult() };
+            for (const auto& item : result.GetItems())
+            {
+                auto playerID{ item.find(DATA_KEY_ID) };
+                if (playerID != item.end())
+                {
+                    playerFilter.Add(playerID->second.GetS());
+                }
+            }
+            lastEvaluatedKey = result.GetLastEvaluatedKey();
+        } while (!lastEvaluatedKey.empty());
+
+        s_playerFilter.Swap(playerFilter);
+        s_usePlayerFilter = true;
+        cout << "Missing player filter built from " << s_playerFilter.GetPlayerCount() << " players" << endl;
+        return true;
+    }
+
+    bool QueryPlayerDesc(const string& ID, PlayerDesc& playerDesc, Deadline deadline)
     {
         // first grab player attributes
-        Aws::DynamoDB::Model::QueryRequest queryRequest;
-        queryRequest.SetTableName(PLAYER_DATA_TABLE_NAME);
-        string conditionExpression{ DATA_KEY_ID };
-        conditionExpression += " = :id";
-        queryRequest.SetKeyConditionExpression(conditionExpression); //https://docs.aws.amazon.com/amazondynamodb/latest/developerguide/Query.html
-        Aws::DynamoDB::Model::AttributeValue avID;
-        avID.SetS(ID);
-        map<string, Aws::DynamoDB::Model::AttributeValue> attributeValues;
-        attributeValues[":id"] = avID;
-        queryRequest.SetExpressionAttributeValues(attributeValues);
-        auto outcome{ s_DynamoDBClient->Query(queryRequest) };
+        Aws::DynamoDB::Model::QueryOutcome outcome;
+        if (!HedgedQuery(MakePlayerQueryRequest(ID), deadline, outcome))
+        {
+            cout << "Query for player " << ID << " missed its deadline" << endl;
+            return false;
+        }
+
         if (outcome.IsSuccess())
         {
             auto result{ outcome.GetResult() };
@@ -125,10 +361,11 @@ namespace AmazingRPG
                 cout << "Multiple records found for ID " << ID << " returning first found only!" << endl;
             }
 
-            auto item = result.GetItems()[0];
-            playerDesc.id = item[DATA_KEY_ID].GetS();   // we already know this, just showing how to read it
-            playerDesc.strength = stoi(item[DATA_KEY_STRENGTH].GetN());
-            playerDesc.intellect = stoi(item[DATA_KEY_INTELLECT].GetN());
+            if (!ReadPlayerDescFromItem(result.GetItems()[0], playerDesc))
+            {
+                cout << "Badly formed player record for ID " << ID << endl;
+                return false;
+            }
         }
         else
         {
@@ -138,6 +375,55 @@ namespace AmazingRPG
 
         return true;
     }
+
+    bool LoadPlayerDesc(const string& ID, PlayerDesc& playerDesc, Deadline deadline)
+    {
+        if (s_useInMemoryStorage)
+        {
+            if (!s_inMemoryPlayers.Get(ID, playerDesc))
+            {
+                cout << "No player description returned for ID " << ID << endl;
+                return false;
+            }
+            return true;
+        }
+
+        if (!s_hotKeys.IsHot(ID))
+        {
+            return QueryPlayerDesc(ID, playerDesc, deadline);
+        }
+
+        // hot players are served from memory, a pinned copy saves the read entirely
+        if (s_hotPlayers.Get(ID, playerDesc))
+        {
+            ++s_hotKeyStats.pinnedHits;
+            return true;
+        }
+
+        ++s_hotKeyStats.backendReads;
+        if (!QueryPlayerDesc(ID, playerDesc, deadline))
+        {
+            return false;
+        }
+        s_hotPlayers.Pin(playerDesc);
+        return true;
+    }
+
+    bool GetPlayerDesc(const string& ID, PlayerDesc& playerDesc, Deadline deadline)
+    {
+        if (!PlayerMightExist(ID) || !LoadPlayerDesc(ID, playerDesc, deadline))
+        {
+            return false;
+        }
+        s_playerVersions.OnRead(playerDesc);
+        return true;
+    }
+
+    bool GetPlayerDesc(const string& ID, PlayerDesc& playerDesc)
+    {
+        return GetPlayerDesc(ID, playerDesc, MakeDeadline());
+    }
+
     int AskForNewAttributeValue(const string& attributeText)
     {
         cout << "Type the new "<< attributeText << " as a positive integer:  ";
@@ -151,10 +437,10 @@ namespace AmazingRPG
         return level;
     }
 
-    string FetchPlayerDescAsString(const string& ID)
+    string FetchPlayerDescAsString(const string& ID, Deadline deadline)
     {
         PlayerDesc playerDesc;
-        if (GetPlayerDesc(ID, playerDesc))
+        if (GetPlayerDesc(ID, playerDesc, deadline))
         {
             return playerDesc.GetString();
         }
@@ -174,33 +460,57 @@ namespace AmazingRPG
         }
     }
 
-    bool SetPlayerAttribueValue(const string& ID, const string& attributeKey, int newValue)
+    // Remembers a stat change for the subscribers of this player, several changes to the
+    // same player in one tick go out as a single message
+    void QueuePlayerDelta(const string& ID, const string& attributeKey, int newValue, unsigned long long newVersion)
     {
-        Aws::DynamoDB::Model::UpdateItemRequest updateItemRequest;
-        updateItemRequest.SetTableName(PLAYER_DATA_TABLE_NAME);
+        char fieldCode{ GetFieldCodeForAttribute(attributeKey) };
+        s_hotPlayers.UpdateStat(ID, fieldCode, newValue, newVersion);
+        s_playerVersions.OnWrite(ID, fieldCode, newVersion);
+        if (fieldCode != 0 && s_subscriptions.count(ID) > 0)
+        {
+            s_pendingDeltas[ID][fieldCode] = newValue;
+        }
+    }
 
-        // It's worth noting that the current AWS C++ SDK example for upating an
-        // item is incorrect, AttributeUpdates are no longer used, you need
-        // to use update expressions instead: https://docs.aws.amazon.com/amazondynamodb/latest/developerguide/Expressions.UpdateExpressions.html
-        Aws::DynamoDB::Model::AttributeValue avID;
-        avID.SetS(ID);
-        updateItemRequest.AddKey(DATA_KEY_ID, avID);
+    void RemoveSubscription(const string& playerID, SOCKET socket)
+    {
+        auto subscription{ s_subscriptions.find(playerID) };
+        if (subscription != s_subscriptions.end())
+        {
+            auto& subscribers{ subscription->second };
+            subscribers.erase(remove(subscribers.begin(), subscribers.end(), socket), subscribers.end());
+            if (subscribers.empty())
+            {
+                s_subscriptions.erase(subscription);
+            }
+        }
+    }
 
-        string updateExpression = "SET ";
-        updateExpression += attributeKey;
-        updateExpression += " = :l";
-        updateItemRequest.SetUpdateExpression(updateExpression);
-        
-        Aws::DynamoDB::Model::AttributeValue av;
-        av.SetN(to_string(newValue));
-        map<string, Aws::DynamoDB::Model::AttributeValue> attributeValues;
-        attributeValues[":l"] = av;
-        updateItemRequest.SetExpressionAttributeValues(attributeValues);
+    bool SetPlayerAttribueValue(const string& ID, const string& attributeKey, int newValue)
+    {
+        if (s_useInMemoryStorage)
+        {
+            unsigned long long newVersion{ 0 };
+            if (!s_inMemoryPlayers.SetStat(ID, GetFieldCodeForAttribute(attributeKey), newValue, newVersion))
+            {
+                cout << "Update player attribute " << attributeKey << " failed: player not found" << endl;
+                return false;
+            }
+            QueuePlayerDelta(ID, attributeKey, newValue, newVersion);
+            return true;
+        }
 
-        auto outcome{ s_DynamoDBClient->UpdateItem(updateItemRequest) };
+        auto outcome{ s_DynamoDBClient->UpdateItem(MakeSetAttributeRequest(ID, attributeKey, newValue)) };
         if (outcome.IsSuccess())
         {
             cout << "Player attribute " << attributeKey << " successfully updated" << endl;
+            auto attributes{ outcome.GetResult().GetAttributes() };
+            unsigned long long newVersion{ 0 };
+            if (ParseUnsigned(attributes[DATA_KEY_VERSION].GetN(), newVersion))
+            {
+                QueuePlayerDelta(ID, attributeKey, newValue, newVersion);
+            }
             return true;
         }
         else
@@ -210,12 +520,157 @@ namespace AmazingRPG
         }
     }
 
+    struct GrantResult
+    {
+        string playerID;
+        bool success{ false };
+        int newValue{ 0 };
+        string error;
+    };
+
+    // GrantResult errors the callers act on
+    const string GRANT_PLAYER_NOT_FOUND{ "player not found" };
+    const string GRANT_OUT_OF_RANGE{ "the change would take the stat out of range" };
+    // DynamoDB's condition check covers both and doesn't say which failed
+    const string GRANT_CONDITION_FAILED{ "player not found or the change would take the stat out of range" };
+
+    // Applies the same change to every player with all the updates in flight at once.
+    // Each player succeeds or fails on its own
+    vector<GrantResult> GrantAttributeChange(const vector<string>& playerIDs, const string& attributeKey, int amount, Deadline deadline)
+    {
+        vector<GrantResult> results(playerIDs.size());
+        if (s_useInMemoryStorage)
+        {
+            for (size_t playerIdx{ 0 }; playerIdx < playerIDs.size(); ++playerIdx)
+            {
+                GrantResult& result{ results[playerIdx] };
+                result.playerID = playerIDs[playerIdx];
+                unsigned long long newVersion{ 0 };
+                StatChange statChange{ s_inMemoryPlayers.AddToStat(result.playerID, GetFieldCodeForAttribute(attributeKey), amount, result.newValue, newVersion) };
+                result.success = statChange == StatChange::Applied;
+                if (result.success)
+                {
+                    QueuePlayerDelta(result.playerID, attributeKey, result.newValue, newVersion);
+                }
+                else
+                {
+                    result.error = statChange == StatChange::OutOfRange ? GRANT_OUT_OF_RANGE : GRANT_PLAYER_NOT_FOUND;
+                }
+            }
+            return results;
+        }
+
+        // Every update goes out before we wait on any of them, grants are capped at
+        // MAX_GRANT_PLAYERS and the executor limits how many actually run at once.
+        // Nothing is sent once the deadline has passed
+        vector<Aws::DynamoDB::Model::UpdateItemOutcomeCallable> pendingUpdates;
+        pendingUpdates.reserve(playerIDs.size());
+        for (const string& playerID : playerIDs)
+        {
+            if (chrono::steady_clock::now() >= deadline)
+            {
+                break;
+            }
+            pendingUpdates.push_back(s_DynamoDBClient->UpdateItemCallable(MakeGrantRequest(playerID, attributeKey, amount)));
+        }
+
+        for (size_t playerIdx{ 0 }; playerIdx < playerIDs.size(); ++playerIdx)
+        {
+            GrantResult& result{ results[playerIdx] };
+            result.playerID = playerIDs[playerIdx];
+            if (playerIdx >= pendingUpdates.size())
+            {
+                result.error = "not attempted, the request ran out of time";
+                continue;
+            }
+
+            auto& pendingUpdate{ pendingUpdates[playerIdx] };
+            if (pendingUpdate.wait_until(deadline) != future_status::ready)
+            {
+                result.error = "timed out, the change may still be applied";
+                continue;
+            }
+
+            auto outcome{ pendingUpdate.get() };
+            if (outcome.IsSuccess())
+            {
+                auto attributes{ outcome.GetResult().GetAttributes() };
+                long long newValue{ 0 };
+                unsigned long long newVersion{ 0 };
+                if (!ParseInteger(attributes[attributeKey].GetN(), INT_MIN, INT_MAX, newValue) || !ParseUnsigned(attributes[DATA_KEY_VERSION].GetN(), newVersion))
+                {
+                    // applied, but we can't tell subscribers the new value
+                    result.error = "applied, but the stored value couldn't be read back";
+                    continue;
+                }
+                result.success = true;
+                result.newValue = static_cast<int>(newValue);
+                QueuePlayerDelta(result.playerID, attributeKey, result.newValue, newVersion);
+            }
+            else if (outcome.GetError().GetErrorType() == Aws::DynamoDB::DynamoDBErrors::CONDITIONAL_CHECK_FAILED)
+            {
+                result.error = GRANT_CONDITION_FAILED;
+            }
+            else
+            {
+                // the reply line may cut the message short, the log has all of it
+                cout << "Grant to player " << result.playerID << " failed: " << outcome.GetError() << endl;
+                result.error = outcome.GetError().GetMessage();
+            }
+        }
+        return results;
+    }
+
+    // Gives a player a large inventory to page through, the items are written 25 at a
+    // time like PopulateDatabases does with players
+    void PopulatePlayerInventory(const string& ID, int itemCount)
+    {
+        const vector<string> ITEM_NAMES{ "Sword", "Shield", "Health Potion", "Mana Potion", "Arrow", "Gold Ring", "Leather Boots", "Scroll of Light" };
+        vector<InventoryItem> itemChunk;
+        int itemsWritten{ 0 };
+        for (int itemIdx{ 0 }; itemIdx < itemCount; ++itemIdx)
+        {
+            InventoryItem item;
+            item.itemID = GetItemIDForInt(itemIdx);
+            item.name = ITEM_NAMES[itemIdx % ITEM_NAMES.size()];
+            item.count = 1 + itemIdx % 5;
+            itemChunk.push_back(item);
+            if (itemChunk.size() < MAX_DYNAMODB_BATCH_ITEMS && itemIdx + 1 < itemCount)
+            {
+                continue;
+            }
+
+            Aws::DynamoDB::Model::BatchWriteItemRequest batchWriteRequest;
+            if (!MakeInventoryChunkWriteRequest(ID, itemChunk, batchWriteRequest))
+            {
+                cout << "Inventory items can't hold '" << PUSH_DELTA_FIELD_END << "' or line breaks" << endl;
+                return;
+            }
+            auto outcome{ s_DynamoDBClient->BatchWriteItem(batchWriteRequest) };
+            if (!outcome.IsSuccess())
+            {
+                cout << "Unable to process batch write request: " << outcome.GetError() << endl;
+                return;
+            }
+            // as with players, unprocessed items aren't retried in this demo
+            auto unprocessedItems{ outcome.GetResult().GetUnprocessedItems() };
+            auto unprocessed{ unprocessedItems.find(INVENTORY_TABLE_NAME) };
+            itemsWritten += static_cast<int>(itemChunk.size() - (unprocessed == unprocessedItems.end() ? 0 : unprocessed->second.size()));
+            itemChunk.clear();
+        }
+        cout << itemsWritten << " items written to the inventory of player " << ID << endl;
+    }
+
     bool PlayerMenu()
     {
         cout << endl << "What would you like to do?" << endl;
         cout << "\t1. View Player" << endl;
         cout << "\t2. Increase player strength" << endl;
         cout << "\t3. Increase player intellect" << endl;
+        cout << "\t4. Build missing player filter from a table scan" << endl;
+        cout << "\t5. Load missing player filter from a file" << endl;
+        cout << "\t6. Save missing player filter to a file" << endl;
+        cout << "\t7. Populate player inventory with fake items" << endl;
         cout << "\t9. Quit" << endl;
         cout << endl << "Your choice? ";
 
@@ -245,234 +700,988 @@ namespace AmazingRPG
                 }
                 else
                 {
-                    cout << "No valid value to set, ignoring" << endl;
+                    cout << "No valid value to set, ignoring" << endl;
+                }
+                break;
+            }
+
+        case 3:
+        {
+            auto ID = AskForPlayerID();
+            auto newValue = AskForNewAttributeValue("intellect");
+            if (newValue > 0)
+            {
+                SetPlayerAttribueValue(ID, DATA_KEY_INTELLECT, newValue);
+            }
+            else
+            {
+                cout << "No valid value to set, ignoring" << endl;
+            }
+            break;
+        }
+
+        case 4:
+            BuildPlayerFilterFromScan();
+            break;
+
+        case 5:
+        {
+            cout << "Filter file to load: ";
+            string fileName;
+            cin >> fileName;
+            if (s_playerFilter.Load(fileName))
+            {
+                s_usePlayerFilter = true;
+                cout << "Missing player filter loaded with " << s_playerFilter.GetPlayerCount() << " players" << endl;
+            }
+            else
+            {
+                cout << "Unable to load a missing player filter from " << fileName << endl;
+            }
+            break;
+        }
+
+        case 6:
+        {
+            cout << "Filter file to save: ";
+            string fileName;
+            cin >> fileName;
+            if (s_playerFilter.Save(fileName))
+            {
+                cout << "Missing player filter saved with " << s_playerFilter.GetPlayerCount() << " players" << endl;
+            }
+            else
+            {
+                cout << "Unable to save the missing player filter to " << fileName << endl;
+            }
+            break;
+        }
+
+        case 7:
+        {
+            auto ID = AskForPlayerID();
+            cout << "How many items should the player have? ";
+            int itemCount{ 0 };
+            cin >> itemCount;
+            if (cin.fail() || itemCount <= 0)
+            {
+                cin.clear();
+                cin.ignore(numeric_limits<streamsize>::max(), '\n');
+                cout << "You didn't enter a positive integer" << endl;
+                break;
+            }
+            PopulatePlayerInventory(ID, itemCount);
+            break;
+        }
+
+        case 9:
+            return false;
+
+        default:
+            cout << "That choice doesn't exist, please try again." << endl << endl;
+        }
+        return true;
+    }
+
+    void EmulatePlayerMenu()
+    {
+        while (PlayerMenu())
+        {
+            std::this_thread::sleep_for(std::chrono::seconds(0));
+        }
+    }
+
+    void ShowTopTenPlayers()
+    {
+    }
+
+	void SendPlayerChunkToDynamoDB(const vector<PlayerDesc>& playerChunk)
+	{
+		assert(playerChunk.size() <= MAX_DYNAMODB_BATCH_ITEMS);
+		auto batchWriteRequest{ MakePlayerChunkWriteRequest(playerChunk) };
+
+        auto outcome{ s_DynamoDBClient->BatchWriteItem(batchWriteRequest) };
+		if (outcome.IsSuccess())
+		{
+            auto result{ outcome.GetResult() };
+			if (result.GetUnprocessedItems().size() > 0)
+			{
+                // if there are unprocessed items, you'd typically do a retry here
+                // with exponential falloff, however for this small demo we won't
+                // get more than one call to DyanamoDB so it's not needed
+            }
+			else
+			{
+				cout << "Chunk successfully sent to DynamoDB!" << endl;
+			}
+
+            // unprocessed players are added too, the filter can say yes to a missing player but never no to a real one
+            for (const PlayerDesc& playerDesc : playerChunk)
+            {
+                s_playerFilter.Add(playerDesc.id);
+            }
+		}
+		else
+		{
+			cout << "Unable to process batch write request: " << outcome.GetError() << endl;
+		}
+	}
+
+	// This is here to show how to use the DescribeTable and BatchWrite operations
+	// however, I would strongly recommend tools like this be written as
+	// AWS Lambdas if possible. Your server and even your custom tools
+	// shouldn't do this type of thing as it is a waste of your
+	// bandwidth allowance and would generally be cheaper to run in AWS
+	bool PopulateDatabases()
+    {
+        // Check that DynamoDB table isn't already populated
+		// we don't want to add a bunch of entries accidentally
+        PlayerDesc _unused;
+        if (GetPlayerDesc(GetPlayerIDForInt(1), _unused))
+        {
+            cout << "The database is already populated, exiting" << endl;
+            return false;
+        }
+
+		cout << "This could take many minutes, please be patient" << endl;
+
+        // Create a bunch of random characters
+        const int NUMBER_OF_CHARACTERS_TO_CREATE{ 1000 };
+        PlayerColumns newPlayers;
+        newPlayers.Resize(NUMBER_OF_CHARACTERS_TO_CREATE);
+        GeneratePlayers(MakeRandomPlayerGeneratorSettings(), newPlayers);
+
+		vector<PlayerDesc> newPlayerChunk;
+		for (size_t chrIdx{ 0 }; chrIdx < newPlayers.count; ++chrIdx)
+		{
+			// Write the characters to DynamoDB
+			// DynamoDB can write up to 16MB of data in one shot but only process 25 items in one
+			// request, so we'll chunk through every 25
+			newPlayerChunk.push_back(newPlayers.GetPlayerDesc(chrIdx));
+			if (newPlayerChunk.size() == MAX_DYNAMODB_BATCH_ITEMS)
+			{
+				cout << "Sending player chunk to DynamoDB..." << endl;
+				SendPlayerChunkToDynamoDB(newPlayerChunk);
+                newPlayerChunk.clear();
+            }
+        }
+
+
+		return true;
+    }
+
+    // Generates a large synthetic population without sending it anywhere, this is
+    // for building load test data sets and checking how fast we can generate them
+    void GenerateSyntheticPlayers()
+    {
+        cout << "How many players should be generated? ";
+        long long playerCount{ 0 };
+        cin >> playerCount;
+        if (cin.fail() || playerCount <= 0)
+        {
+            cin.clear();
+            cin.ignore(numeric_limits<streamsize>::max(), '\n');
+            cout << "You didn't enter a positive integer" << endl;
+            return;
+        }
+
+        // the same seed always generates the same players, so data sets can be rebuilt
+        cout << "Seed to generate from (0 for a random seed)? ";
+        uint64_t seed{ 0 };
+        cin >> seed;
+        if (cin.fail())
+        {
+            cin.clear();
+            cin.ignore(numeric_limits<streamsize>::max(), '\n');
+            seed = 0;
+        }
+
+        PlayerGeneratorSettings settings{ MakeRandomPlayerGeneratorSettings() };
+        if (seed != 0)
+        {
+            settings.seed = seed;
+        }
+
+        // the sink gets called from every generator thread, so only touch atomics in here
+        atomic<long long> strengthTotal{ 0 };
+        atomic<long long> intellectTotal{ 0 };
+
+        auto startTime{ chrono::steady_clock::now() };
+        GeneratePlayers(settings, 0, static_cast<size_t>(playerCount), [&](const PlayerColumns& block)
+        {
+            long long blockStrength{ 0 };
+            long long blockIntellect{ 0 };
+            for (size_t row{ 0 }; row < block.count; ++row)
+            {
+                blockStrength += block.strength[row];
+                blockIntellect += block.intellect[row];
+            }
+            strengthTotal += blockStrength;
+            intellectTotal += blockIntellect;
+        });
+        chrono::duration<double> elapsed{ chrono::steady_clock::now() - startTime };
+
+        cout << "Generated " << playerCount << " players in " << elapsed.count() << " seconds ("
+             << static_cast<long long>(playerCount / max(elapsed.count(), 1e-9) * 60.0) << " players per minute)" << endl;
+        cout << "\tSeed: " << settings.seed << endl;
+        cout << "\tAverage strength: " << static_cast<double>(strengthTotal) / playerCount << endl;
+        cout << "\tAverage intellect: " << static_cast<double>(intellectTotal) / playerCount << endl;
+    }
+
+    // sorts the samples in place
+    double GetPercentile(vector<double>& samples, double percentile)
+    {
+        if (samples.empty())
+        {
+            return 0.0;
+        }
+        size_t index{ static_cast<size_t>(percentile / 100.0 * (samples.size() - 1)) };
+        nth_element(samples.begin(), samples.begin() + index, samples.end());
+        return samples[index];
+    }
+
+    struct ClientBenchmarkCase
+    {
+        string name;
+        DynamoDBClientSettings settings;
+        size_t workerThreads{ 1 };
+        // queries each worker keeps in flight, they run on the client's executor
+        size_t queriesInFlight{ 1 };
+    };
+
+    // Hammers DynamoDB with player queries from a number of worker threads using one
+    // client configuration and reports requests/sec and latency. Queries go through
+    // QueryCallable so they run on the configured executor, a worker only waits once
+    // it has queriesInFlight outstanding
+    void RunClientBenchmarkCase(const ClientBenchmarkCase& benchmarkCase, int playerCount, chrono::seconds duration)
+    {
+        DynamoDBClientPool clientPool{ benchmarkCase.settings };
+
+        mutex latencyMutex;
+        vector<double> latenciesMs;
+        atomic<long long> errorCount{ 0 };
+        const auto startTime{ chrono::steady_clock::now() };
+        const auto endTime{ startTime + duration };
+
+        auto worker = [&](size_t workerIdx)
+        {
+            const auto& client{ clientPool.GetClient(workerIdx) };
+            vector<double> workerLatenciesMs;
+            // oldest first, each with the time it was sent
+            deque<pair<chrono::steady_clock::time_point, Aws::DynamoDB::Model::QueryOutcomeCallable>> inFlight;
+            int playerIdx{ static_cast<int>(workerIdx) };
+            while (chrono::steady_clock::now() < endTime || !inFlight.empty())
+            {
+                if (chrono::steady_clock::now() < endTime && inFlight.size() < benchmarkCase.queriesInFlight)
+                {
+                    auto queryRequest{ MakePlayerQueryRequest(GetPlayerIDForInt(playerIdx % playerCount)) };
+                    playerIdx += static_cast<int>(benchmarkCase.workerThreads);
+                    inFlight.emplace_back(chrono::steady_clock::now(), client->QueryCallable(queryRequest));
+                    continue;
+                }
+
+                auto outcome{ inFlight.front().second.get() };
+                chrono::duration<double, milli> latency{ chrono::steady_clock::now() - inFlight.front().first };
+                inFlight.pop_front();
+                if (outcome.IsSuccess())
+                {
+                    workerLatenciesMs.push_back(latency.count());
+                }
+                else
+                {
+                    ++errorCount;
+                }
+            }
+
+            lock_guard<mutex> lock{ latencyMutex };
+            latenciesMs.insert(latenciesMs.end(), workerLatenciesMs.begin(), workerLatenciesMs.end());
+        };
+
+        vector<thread> workers;
+        for (size_t workerIdx{ 0 }; workerIdx < benchmarkCase.workerThreads; ++workerIdx)
+        {
+            workers.emplace_back(worker, workerIdx);
+        }
+        for (auto& workerThread : workers)
+        {
+            workerThread.join();
+        }
+
+        // the last queries finish after endTime, so divide by the time actually taken
+        chrono::duration<double> elapsed{ chrono::steady_clock::now() - startTime };
+        double requestsPerSecond{ latenciesMs.size() / max(elapsed.count(), 1e-9) };
+        cout << setw(50) << left << benchmarkCase.name << right
+             << setw(10) << fixed << setprecision(1) << requestsPerSecond
+             << setw(10) << GetPercentile(latenciesMs, 50.0)
+             << setw(10) << GetPercentile(latenciesMs, 99.0)
+             << setw(8) << errorCount << endl;
+        cout.unsetf(ios_base::floatfield);
+    }
+
+    // Sweeps connection pool size and client sharing, then varies the executor size,
+    // keep-alive and timeouts one at a time from a baseline, so a production
+    // configuration can be picked from data. Point it at DynamoDB Local
+    // (https://docs.aws.amazon.com/amazondynamodb/latest/developerguide/DynamoDBLocal.html)
+    // rather than burning capacity on the real table. The players come from main menu
+    // option 7, which writes to DYNAMODB_ENDPOINT_OVERRIDE and not the endpoint typed in
+    // here, so set the override in Settings.h to DynamoDB Local before populating and
+    // answer - to benchmark the same endpoint
+    void BenchmarkClientConfigurations()
+    {
+        cout << "Endpoint to benchmark against (e.g. http://localhost:8000, - for the default endpoint): ";
+        string endpoint;
+        cin >> endpoint;
+        if (endpoint == "-")
+        {
+            endpoint = DYNAMODB_ENDPOINT_OVERRIDE;
+        }
+
+        const int PLAYER_COUNT{ 1000 };
+        const chrono::seconds CASE_DURATION{ 5 };
+        const size_t WORKER_THREADS{ 8 };
+        const size_t QUERIES_IN_FLIGHT{ 8 };
+
+        ClientBenchmarkCase baseline;
+        baseline.settings.endpointOverride = endpoint;
+        baseline.workerThreads = WORKER_THREADS;
+        baseline.queriesInFlight = QUERIES_IN_FLIGHT;
+
+        vector<ClientBenchmarkCase> benchmarkCases;
+        for (unsigned maxConnections : { 4u, 16u, 64u })
+        {
+            for (size_t clientCount : { size_t{ 1 }, WORKER_THREADS })
+            {
+                ClientBenchmarkCase benchmarkCase{ baseline };
+                benchmarkCase.settings.maxConnections = maxConnections;
+                benchmarkCase.settings.clientCount = clientCount;
+                benchmarkCase.name = (clientCount == 1 ? "shared client, " : "per worker client, ") + to_string(maxConnections) + " connections";
+                benchmarkCases.push_back(benchmarkCase);
+            }
+        }
+
+        // the rest change one setting from the baseline, a shared client with the default pool size
+        baseline.name = "shared client, " + to_string(baseline.settings.maxConnections) + " connections";
+        for (size_t executorThreads : { size_t{ 0 }, size_t{ 2 }, size_t{ 8 }, size_t{ 32 } })
+        {
+            ClientBenchmarkCase benchmarkCase{ baseline };
+            benchmarkCase.settings.executorThreads = executorThreads;
+            benchmarkCase.name += executorThreads == 0 ? ", default executor" : ", " + to_string(executorThreads) + " executor threads";
+            benchmarkCases.push_back(benchmarkCase);
+        }
+
+        ClientBenchmarkCase noKeepAlive{ baseline };
+        noKeepAlive.settings.enableTcpKeepAlive = false;
+        noKeepAlive.name += ", no keep-alive";
+        benchmarkCases.push_back(noKeepAlive);
+
+        for (long requestTimeoutMs : { 100l, 500l, 3000l })
+        {
+            ClientBenchmarkCase benchmarkCase{ baseline };
+            benchmarkCase.settings.requestTimeoutMs = requestTimeoutMs;
+            benchmarkCase.name += ", " + to_string(requestTimeoutMs) + "ms request timeout";
+            benchmarkCases.push_back(benchmarkCase);
+        }
+
+        for (long connectTimeoutMs : { 100l, 1000l })
+        {
+            ClientBenchmarkCase benchmarkCase{ baseline };
+            benchmarkCase.settings.connectTimeoutMs = connectTimeoutMs;
+            benchmarkCase.name += ", " + to_string(connectTimeoutMs) + "ms connect timeout";
+            benchmarkCases.push_back(benchmarkCase);
+        }
+
+        cout << "Running " << benchmarkCases.size() << " cases of " << CASE_DURATION.count() << " seconds with "
+             << WORKER_THREADS << " worker threads each keeping " << QUERIES_IN_FLIGHT << " queries in flight" << endl;
+        cout << setw(50) << left << "Configuration" << right << setw(10) << "req/s" << setw(10) << "p50 ms"
+             << setw(10) << "p99 ms" << setw(8) << "errors" << endl;
+        for (const auto& benchmarkCase : benchmarkCases)
+        {
+            RunClientBenchmarkCase(benchmarkCase, PLAYER_COUNT, CASE_DURATION);
+        }
+    }
+
+    // the node a player should be sent to, null when this server owns them
+    const ClusterNode* GetRemoteOwner(const string& playerID)
+    {
+        if (s_localNode == nullptr)
+        {
+            return nullptr;
+        }
+
+        const ClusterNode* owner{ s_clusterRing.GetOwner(playerID) };
+        if (owner == s_localNode)
+        {
+            ++s_ownedRequests;
+            return nullptr;
+        }
+        ++s_redirectedRequests;
+        return owner;
+    }
+
+    void ReportClusterStats()
+    {
+        if (s_localNode == nullptr)
+        {
+            return;
+        }
+        cout << "Cluster node " << s_localNode->name << ": " << s_ownedRequests << " players served here, "
+             << s_redirectedRequests << " redirected to other nodes" << endl;
+    }
+
+    void CopyStringToWriteBuffer(const string& message, SocketInformation& socketInfo)
+    {
+        // anything that doesn't fit gets cut off rather than running over the buffer,
+        // the REPLY_END always goes on so the client knows the reply is over
+        size_t messageSize{ min(message.size(), SOCKET_BUFFER_SIZE - 1) };
+        copy(message.begin(), message.begin() + messageSize, socketInfo.writeBuffer);
+        socketInfo.writeBuffer[messageSize] = REPLY_END;
+        socketInfo.bytesSEND = static_cast<int>(messageSize + 1);
+    }
+
+    string GetPlayerLookupFailure(const string& playerID, Deadline deadline)
+    {
+        if (chrono::steady_clock::now() >= deadline)
+        {
+            return "Request for player ID " + playerID + " timed out";
+        }
+        return "Unable to find player ID " + playerID;
+    }
+
+    // Drops the connection's listing and any page read still running for it. Pages
+    // already queued still go out
+    void StopInventoryListing(SocketInformation& socketInfo)
+    {
+        socketInfo.inventoryCursor.pagesLeft = 0;
+        s_inventoryQueries.erase(socketInfo.connectionID);
+    }
+
+    void ProcessGrant(SocketInformation& socketInfo)
+    {
+        GrantRequest grantRequest;
+        string error;
+        if (!ParseGrantRequest(socketInfo.readBuffer, socketInfo.bytesRECV, grantRequest, error))
+        {
+            CopyStringToWriteBuffer(error, socketInfo);
+            return;
+        }
+
+        // a grant can span nodes, we only change the players we own and report the rest
+        // with their owner so the client can send them there
+        vector<string> ownedPlayerIDs;
+        vector<GrantResult> results;
+        for (const string& playerID : grantRequest.playerIDs)
+        {
+            const ClusterNode* owner{ GetRemoteOwner(playerID) };
+            if (owner == nullptr && PlayerMightExist(playerID))
+            {
+                ownedPlayerIDs.push_back(playerID);
+            }
+            else if (owner == nullptr)
+            {
+                GrantResult result;
+                result.playerID = playerID;
+                result.error = "no such player";
+                results.push_back(result);
+            }
+            else
+            {
+                GrantResult result;
+                result.playerID = playerID;
+                result.error = "owned by " + owner->host + ":" + to_string(owner->port);
+                results.push_back(result);
+            }
+        }
+
+        const string& attrKey{ GetAttributeForFieldCode(grantRequest.fieldCode) };
+        auto ownedResults{ GrantAttributeChange(ownedPlayerIDs, attrKey, grantRequest.amount, socketInfo.requestDeadline) };
+        results.insert(results.end(), ownedResults.begin(), ownedResults.end());
+
+        // every line is bounded, so the whole reply fits in the write buffer however the players fared
+        string message;
+        message.reserve(results.size() * MAX_GRANT_RESULT_SIZE);
+        for (const GrantResult& result : results)
+        {
+            AppendGrantResult(message, result.playerID, result.success ? attrKey + " " + to_string(result.newValue) : "failed: " + result.error);
+        }
+        CopyStringToWriteBuffer(message, socketInfo);
+    }
+
+    void ProcessSocket(SocketInformation& socketInfo)
+    {
+        if (socketInfo.bytesRECV > 0 && socketInfo.readBuffer[0] == GRANT)
+        {
+            // grants carry a list of players, so they don't fit the fixed size requests below
+            StopInventoryListing(socketInfo);
+            ProcessGrant(socketInfo);
+        }
+        else if (socketInfo.bytesRECV > 0)
+        {
+            // demo is very limited in its socket abilites as we want to show the database, not how to make a socket server :)
+            PlayerRequest request;
+            string error;
+            if (!ParsePlayerRequest(socketInfo.readBuffer, socketInfo.bytesRECV, request, error))
+            {
+                cout << error << endl;
+                CopyStringToWriteBuffer(error, socketInfo);
+                return;
+            }
+
+            if (request.hasExtraData)
+            {
+                cout << "Socket received more data than expected, only attempting to process 1 data item" << endl;
+            }
+
+            const string& playerID{ request.playerID };
+            const char controlCode{ request.controlCode };
+
+            // any new request means the client has moved on from its listing, so no more
+            // pages get mixed in with the replies. A new listing starts below
+            StopInventoryListing(socketInfo);
+            if (controlCode == INVENTORY && request.continuationToken.size() == 1 && request.continuationToken[0] == INVENTORY_CANCEL)
+            {
+                // confirmed through the push queue so it goes out after any page already queued,
+                // the client can drop everything up to it. Answered for any player, owned here or not
+                static const auto INVENTORY_CANCELLED_MESSAGE{ make_shared<const string>(string{ INVENTORY_END, INVENTORY_CANCEL, PUSH_DELTA_END }) };
+                socketInfo.pushQueue.push_back(INVENTORY_CANCELLED_MESSAGE);
+                return;
+            }
+
+            // players owned by another node are never read here, the client reconnects to the owner
+            const ClusterNode* owner{ GetRemoteOwner(playerID) };
+            if (owner != nullptr)
+            {
+                CopyStringToWriteBuffer(EncodeRedirect(owner->host, owner->port), socketInfo);
+                return;
+            }
+
+            // players we know don't exist are turned away before they cost a read or skew the hot keys
+            if ((controlCode == VIEW || controlCode == VIEW_IF_NEWER || controlCode == STR || controlCode == INT || controlCode == SUBSCRIBE || controlCode == INVENTORY)
+                && !PlayerMightExist(playerID))
+            {
+                CopyStringToWriteBuffer("Unable to find player ID " + playerID, socketInfo);
+                return;
+            }
+
+            // count every single player request so celebrity players get pinned in memory
+            if (controlCode == VIEW || controlCode == VIEW_IF_NEWER || controlCode == STR || controlCode == INT || controlCode == SUBSCRIBE)
+            {
+                ++s_hotKeyStats.requests;
+                s_hotKeys.Record(playerID);
+            }
+
+            if(controlCode == VIEW)
+            {
+                string playerDescString{ FetchPlayerDescAsString(playerID, socketInfo.requestDeadline) };
+                if(playerDescString.empty())
+                {
+                    CopyStringToWriteBuffer(GetPlayerLookupFailure(playerID, socketInfo.requestDeadline), socketInfo);
+                }
+                else
+                {
+                    CopyStringToWriteBuffer(playerDescString, socketInfo);
+                }
+            }
+            else if (controlCode == VIEW_IF_NEWER)
+            {
+                PlayerDesc playerDesc;
+                if (!GetPlayerDesc(playerID, playerDesc, socketInfo.requestDeadline))
+                {
+                    CopyStringToWriteBuffer(GetPlayerLookupFailure(playerID, socketInfo.requestDeadline), socketInfo);
+                }
+                else if (playerDesc.version <= request.knownVersion)
+                {
+                    CopyStringToWriteBuffer(string{ NOT_MODIFIED }, socketInfo);
+                }
+                else
+                {
+                    map<char, int> fields{ { STR, playerDesc.strength }, { INT, playerDesc.intellect } };
+                    vector<char> changedFields;
+                    if (s_playerVersions.GetChangedFields(playerID, request.knownVersion, playerDesc.version, changedFields))
+                    {
+                        map<char, int> changed;
+                        for (char fieldCode : changedFields)
+                        {
+                            changed[fieldCode] = fields[fieldCode];
+                        }
+                        fields.swap(changed);
+                    }
+                    CopyStringToWriteBuffer(EncodeVersionedDelta(playerDesc.version, fields), socketInfo);
+                }
+            }
+            else if(controlCode == STR || controlCode == INT)
+            {
+                // demo just adjusts by 1. The increment goes out as an ADD like a grant, a
+                // read then SET could be working from a pinned copy and lose other writes
+                string attrKey{ controlCode == STR ? DATA_KEY_STRENGTH : DATA_KEY_INTELLECT };
+                GrantResult result{ GrantAttributeChange({ playerID }, attrKey, 1, socketInfo.requestDeadline).front() };
+                if (result.success)
+                {
+                    stringstream outstr;
+                    outstr << "Attribute " << attrKey << " increased to " << result.newValue;
+                    CopyStringToWriteBuffer(outstr.str(), socketInfo);
+                }
+                else if (result.error == GRANT_PLAYER_NOT_FOUND || chrono::steady_clock::now() >= socketInfo.requestDeadline)
+                {
+                    CopyStringToWriteBuffer(GetPlayerLookupFailure(playerID, socketInfo.requestDeadline), socketInfo);
+                }
+                else
+                {
+                    CopyStringToWriteBuffer("Unable to adjust player attribute value for " + attrKey + ": " + result.error, socketInfo);
+                }
+            }
+            else if (controlCode == SUBSCRIBE)
+            {
+                // the reply carries the current stats, so the client never has to VIEW again
+                PlayerDesc playerDesc;
+                if (GetPlayerDesc(playerID, playerDesc, socketInfo.requestDeadline))
+                {
+                    auto& subscribers{ s_subscriptions[playerID] };
+                    if (find(subscribers.begin(), subscribers.end(), socketInfo.socket) == subscribers.end())
+                    {
+                        subscribers.push_back(socketInfo.socket);
+                        socketInfo.subscribedPlayers.push_back(playerID);
+                    }
+                    CopyStringToWriteBuffer(EncodePlayerDelta(playerID, { { STR, playerDesc.strength }, { INT, playerDesc.intellect } }), socketInfo);
+                }
+                else
+                {
+                    CopyStringToWriteBuffer(GetPlayerLookupFailure(playerID, socketInfo.requestDeadline), socketInfo);
+                }
+            }
+            else if (controlCode == UNSUBSCRIBE)
+            {
+                RemoveSubscription(playerID, socketInfo.socket);
+                auto& subscribedPlayers{ socketInfo.subscribedPlayers };
+                subscribedPlayers.erase(remove(subscribedPlayers.begin(), subscribedPlayers.end(), playerID), subscribedPlayers.end());
+                CopyStringToWriteBuffer("Unsubscribed from player ID " + playerID, socketInfo);
+            }
+            else if (controlCode == INVENTORY)
+            {
+                // nothing is read here, StreamInventoryPages sends the pages as the client takes them
+                string lastItemID;
+                if (s_useInMemoryStorage)
+                {
+                    CopyStringToWriteBuffer("Inventories are only kept in DynamoDB", socketInfo);
+                }
+                else if (!DecodeContinuationToken(request.continuationToken, playerID, lastItemID))
+                {
+                    CopyStringToWriteBuffer("Invalid continuation token", socketInfo);
+                }
+                else
+                {
+                    // a new listing replaces any the client hadn't finished
+                    socketInfo.inventoryCursor = { playerID, lastItemID, INVENTORY_PAGES_PER_REQUEST };
+                }
+            }
+            else
+            {
+                CopyStringToWriteBuffer("Invalid control code sent to server", socketInfo);
+            }
+        }
+    }
+
+    // Reads the items out of a page, nextItemID is where the following page starts and
+    // is empty when there are no more. Items that can't be listed are left out
+    bool ReadInventoryPage(const string& ID, const Aws::DynamoDB::Model::QueryOutcome& outcome, vector<InventoryItem>& items, string& nextItemID)
+    {
+        if (!outcome.IsSuccess())
+        {
+            cout << "Error querying DynamoDB: " << outcome.GetError() << endl;
+            return false;
+        }
+
+        const auto& result{ outcome.GetResult() };
+        items.clear();
+        items.reserve(result.GetItems().size());
+        for (const auto& item : result.GetItems())
+        {
+            InventoryItem inventoryItem;
+            if (!ReadInventoryItemFromItem(item, inventoryItem))
+            {
+                cout << "Skipping badly formed inventory item " << inventoryItem.itemID << " of player " << ID << endl;
+                continue;
+            }
+            items.push_back(inventoryItem);
+        }
+        nextItemID = GetLastItemID(result.GetLastEvaluatedKey());
+        return true;
+    }
+
+    // Sends the next page of each inventory listing, but only to connections that have
+    // taken everything already queued for them. A slow client holds up its own listing
+    // rather than piling pages up in memory. Page reads run on the inventory client's
+    // executor and are only checked here, so the server loop never waits on one
+    void StreamInventoryPages(vector<SocketInformation>& socketList)
+    {
+        for (SocketInformation& socketInfo : socketList)
+        {
+            InventoryCursor& cursor{ socketInfo.inventoryCursor };
+            if (cursor.pagesLeft == 0)
+            {
+                continue;
+            }
+
+            auto pageQuery{ s_inventoryQueries.find(socketInfo.connectionID) };
+            if (pageQuery == s_inventoryQueries.end())
+            {
+                if (socketInfo.bytesSEND == 0 && socketInfo.pushQueue.empty() && s_inventoryQueries.size() < INVENTORY_MAX_QUERIES_IN_FLIGHT)
+                {
+                    auto queryRequest{ MakeInventoryPageRequest(cursor.playerID, cursor.lastItemID, INVENTORY_PAGE_SIZE) };
+                    s_inventoryQueries.emplace(socketInfo.connectionID, InventoryPageQuery{ MakeDeadline(), s_inventoryClient->QueryCallable(queryRequest) });
                 }
-                break;
+                continue;
             }
 
-        case 3:
-        {
-            auto ID = AskForPlayerID();
-            auto newValue = AskForNewAttributeValue("intellect");
-            if (newValue > 0)
+            vector<InventoryItem> items;
+            string nextItemID;
+            bool pageRead{ false };
+            if (pageQuery->second.outcome.wait_for(chrono::seconds{ 0 }) == future_status::ready)
             {
-                SetPlayerAttribueValue(ID, DATA_KEY_INTELLECT, newValue);
+                pageRead = ReadInventoryPage(cursor.playerID, pageQuery->second.outcome.get(), items, nextItemID);
+            }
+            else if (chrono::steady_clock::now() < pageQuery->second.deadline)
+            {
+                continue;
             }
             else
             {
-                cout << "No valid value to set, ignoring" << endl;
+                cout << "Inventory query for player " << cursor.playerID << " missed its deadline" << endl;
             }
-            break;
-        }
+            s_inventoryQueries.erase(pageQuery);
 
-        case 9:
-            return false;
+            if (!pageRead || nextItemID.size() > MAX_ITEM_ID_SIZE)
+            {
+                // the listing ends without an INVENTORY_END, so the client knows it didn't get everything
+                cursor.pagesLeft = 0;
+                string message{ "Unable to read the rest of the inventory of player ID " + cursor.playerID };
+                message += PUSH_DELTA_END;
+                socketInfo.pushQueue.push_back(make_shared<const string>(message));
+                continue;
+            }
 
-        default:
-            cout << "That choice doesn't exist, please try again." << endl << endl;
+            string message;
+            for (const InventoryItem& item : items)
+            {
+                AppendInventoryItem(message, item);
+            }
+
+            cursor.lastItemID = nextItemID;
+            --cursor.pagesLeft;
+            if (nextItemID.empty() || cursor.pagesLeft == 0)
+            {
+                cursor.pagesLeft = 0;
+                AppendInventoryEnd(message, EncodeContinuationToken(cursor.playerID, nextItemID));
+            }
+            socketInfo.pushQueue.push_back(make_shared<const string>(message));
         }
-        return true;
     }
 
-    void EmulatePlayerMenu()
+    // Encodes each player's changes once and hands the same message to every subscriber
+    void FlushPlayerDeltas(vector<SocketInformation>& socketList)
     {
-        while (PlayerMenu())
+        if (s_pendingDeltas.empty())
         {
-            std::this_thread::sleep_for(std::chrono::seconds(0));
+            return;
         }
-    }
 
-    void ShowTopTenPlayers()
-    {
-    }
-
-	void SendPlayerChunkToDynamoDB(const vector<PlayerDesc>& playerChunk)
-	{
-		assert(playerChunk.size() <= MAX_DYNAMODB_BATCH_ITEMS);
-		vector<Aws::DynamoDB::Model::WriteRequest> writeRequests;
-		for (const auto& chunkItem : playerChunk)
-		{
-			Aws::DynamoDB::Model::AttributeValue avID;
-			avID.SetS(chunkItem.id);
-			Aws::DynamoDB::Model::AttributeValue avStrength;
-			avStrength.SetN(to_string(chunkItem.strength));
-			Aws::DynamoDB::Model::AttributeValue avIntellect;
-			avIntellect.SetN(to_string(chunkItem.intellect));
-
-			Aws::DynamoDB::Model::PutRequest putRequest;
-			putRequest.AddItem(DATA_KEY_ID, avID);
-			putRequest.AddItem(DATA_KEY_STRENGTH, avStrength);
-			putRequest.AddItem(DATA_KEY_INTELLECT, avIntellect);
-
-			Aws::DynamoDB::Model::WriteRequest curWriteRequest;
-			curWriteRequest.SetPutRequest(putRequest);
-			writeRequests.push_back(curWriteRequest);
-		}
+        unordered_map<SOCKET, SocketInformation*> socketLookup;
+        for (SocketInformation& socketInfo : socketList)
+        {
+            socketLookup[socketInfo.socket] = &socketInfo;
+        }
 
-		Aws::DynamoDB::Model::BatchWriteItemRequest batchWriteRequest;
-		batchWriteRequest.AddRequestItems(PLAYER_DATA_TABLE_NAME, writeRequests);
+        for (const auto& pendingDelta : s_pendingDeltas)
+        {
+            auto subscription{ s_subscriptions.find(pendingDelta.first) };
+            if (subscription == s_subscriptions.end())
+            {
+                continue;
+            }
 
-        auto outcome{ s_DynamoDBClient->BatchWriteItem(batchWriteRequest) };
-		if (outcome.IsSuccess())
-		{
-            auto result{ outcome.GetResult() };
-			if (result.GetUnprocessedItems().size() > 0)
-			{
-                // if there are unprocessed items, you'd typically do a retry here
-                // with exponential falloff, however for this small demo we won't
-                // get more than one call to DyanamoDB so it's not needed
+            auto message{ make_shared<const string>(EncodePlayerDelta(pendingDelta.first, pendingDelta.second)) };
+            for (SOCKET subscriber : subscription->second)
+            {
+                auto socketInfo{ socketLookup.find(subscriber) };
+                if (socketInfo != socketLookup.end())
+                {
+                    socketInfo->second->pushQueue.push_back(message);
+                }
             }
-			else
-			{
-				cout << "Chunk successfully sent to DynamoDB!" << endl;
-			}
-		}
-		else
-		{
-			cout << "Unable to process batch write request: " << outcome.GetError() << endl;
-		}
-	}
+        }
+        s_pendingDeltas.clear();
+    }
 
-	// This is here to show how to use the DescribeTable and BatchWrite operations
-	// however, I would strongly recommend tools like this be written as
-	// AWS Lambdas if possible. Your server and even your custom tools
-	// shouldn't do this type of thing as it is a waste of your
-	// bandwidth allowance and would generally be cheaper to run in AWS
-	bool PopulateDatabases()
+    // Sends the reply in writeBuffer and then any pushed messages until we run out
+    // or the socket would block. Returns false if the socket has to be closed
+    bool SendPendingData(SocketInformation& socketInfo)
     {
-        // Check that DynamoDB table isn't already populated
-		// we don't want to add a bunch of entries accidentally
-        PlayerDesc _unused;
-        if (GetPlayerDesc(GetPlayerIDForInt(1), _unused))
+        while (true)
         {
-            cout << "The database is already populated, exiting" << endl;
-            return false;
-        }
+            // replies go ahead of pushes, but never into the middle of a push frame
+            // that's already partly sent, that would break the subscriber's framing
+            bool sendingReply{ socketInfo.bytesSEND > 0 && socketInfo.pushOffset == 0 };
+            if (sendingReply)
+            {
+                socketInfo.dataBuffer.buf = socketInfo.writeBuffer;
+                socketInfo.dataBuffer.len = socketInfo.bytesSEND;
+            }
+            else if (!socketInfo.pushQueue.empty())
+            {
+                const string& message{ *socketInfo.pushQueue.front() };
+                socketInfo.dataBuffer.buf = const_cast<char*>(message.data()) + socketInfo.pushOffset;
+                socketInfo.dataBuffer.len = static_cast<ULONG>(message.size() - socketInfo.pushOffset);
+            }
+            else
+            {
+                return true;
+            }
 
-		cout << "This could take many minutes, please be patient" << endl;
+            DWORD sendBytes{ 0 };
+            if (WSASend(socketInfo.socket, &(socketInfo.dataBuffer), 1, &sendBytes, 0, nullptr, nullptr) == SOCKET_ERROR)
+            {
+                if (WSAGetLastError() != WSAEWOULDBLOCK)
+                {
+                    std::cout << "Socket write error, closing socket due to error " << WSAGetLastError() << std::endl;
+                    return false;
+                }
+                // try again next time round
+                return true;
+            }
 
-        // Create a bunch of random characters
-        const int NUMBER_OF_CHARACTERS_TO_CREATE{ 1000 };
-		vector<PlayerDesc> newPlayerChunk;
-		for (int chrIdx{ 0 }; chrIdx < NUMBER_OF_CHARACTERS_TO_CREATE; ++chrIdx)
-		{
-            PlayerDesc newPlayer;
-            newPlayer.id = GetPlayerIDForInt(chrIdx);
-            newPlayer.level = s_levelDistribution(s_randomGenerator);
-            newPlayer.strength = GenerateRandomStat();
-			newPlayer.intellect = GenerateRandomStat();
+            bool partialSend{ sendBytes < socketInfo.dataBuffer.len };
+            if (sendingReply)
+            {
+                socketInfo.bytesSEND -= sendBytes;
+                memmove(socketInfo.writeBuffer, socketInfo.writeBuffer + sendBytes, socketInfo.bytesSEND);
+            }
+            else
+            {
+                socketInfo.pushOffset += sendBytes;
+                if (socketInfo.pushOffset == socketInfo.pushQueue.front()->size())
+                {
+                    socketInfo.pushQueue.pop_front();
+                    socketInfo.pushOffset = 0;
+                }
+            }
 
-			// Write the characters to DynamoDB
-			// DynamoDB can write up to 16MB of data in one shot but only process 25 items in one
-			// request, so we'll chunk through every 25
-			newPlayerChunk.push_back(newPlayer);
-			if (newPlayerChunk.size() == MAX_DYNAMODB_BATCH_ITEMS)
-			{
-				cout << "Sending player chunk to DynamoDB..." << endl;
-				SendPlayerChunkToDynamoDB(newPlayerChunk);
-                newPlayerChunk.clear();
+            if (partialSend)
+            {
+                return true;
             }
         }
+    }
 
+    //////////////////////////////////////////////////////////////////////////////
+    // Connection timers
+    enum class SocketEvent
+    {
+        IdleTimeout,
+        SendTimeout,
+        Keepalive,
+    };
+    using SocketEventList = vector<pair<SOCKET, SocketEvent>>;
 
-		return true;
+    // the timer only notes what happened, the server loop acts on it after select
+    // returns, so callbacks never touch a socket that might have been freed
+    void ArmSocketTimer(TimerWheel& timers, SocketEventList& socketEvents, TimerID& timer, SOCKET socket, SocketEvent socketEvent, long delayMs)
+    {
+        timers.Cancel(timer);
+        auto callback = [&socketEvents, socket, socketEvent] { socketEvents.emplace_back(socket, socketEvent); };
+        if (socketEvent == SocketEvent::Keepalive)
+        {
+            timer = timers.ScheduleRepeating(chrono::milliseconds{ delayMs }, callback);
+        }
+        else
+        {
+            timer = timers.Schedule(chrono::milliseconds{ delayMs }, callback);
+        }
     }
 
-    void CopyStringToWriteBuffer(const string& message, SocketInformation& socketInfo)
+    void DisarmSocketTimer(TimerWheel& timers, TimerID& timer)
     {
-        copy(message.begin(), message.end(), socketInfo.writeBuffer);
-        socketInfo.bytesSEND = static_cast<int>(message.size());
+        timers.Cancel(timer);
+        timer = INVALID_TIMER;
     }
 
-    void ProcessSocket(SocketInformation& socketInfo)
+    void HandleSocketEvents(vector<SocketInformation>& socketList, SocketEventList& socketEvents, TimerWheel& timers, vector<SocketInformation>& socketsToFree)
     {
-        if (socketInfo.bytesRECV > 0)
+        static const auto KEEPALIVE_MESSAGE{ make_shared<const string>(string{ KEEPALIVE, PUSH_DELTA_END }) };
+
+        for (const auto& socketEvent : socketEvents)
         {
-            // demo is very limited in its socket abilites as we want to show the database, not how to make a socket server :)
-            if (socketInfo.bytesRECV != ID_SIZE + 1)
+            auto socketInfo{ find_if(socketList.begin(), socketList.end(),
+                [&socketEvent](const SocketInformation& curSocket) { return curSocket.socket == socketEvent.first; }) };
+            if (socketInfo == socketList.end())
             {
-                if (socketInfo.bytesRECV < ID_SIZE + 1)
-                {
-                    cout << "Socket receieved less data than expected, sending error to user" << endl;
-                    CopyStringToWriteBuffer("Socket receieved less data than expected, sending error to user", socketInfo);
-                    return;
-                }
-                else
-                {
-                    cout << "Socket received more data than expected, only attempting to process 1 data item" << endl;
-                }
+                continue;
             }
 
-            // extract user ID
-            string playerID{ socketInfo.readBuffer + 1, static_cast<size_t>(ID_SIZE) };
-
-            // extract control code
-            char controlCode{ socketInfo.readBuffer[0] };
-
-            if(controlCode == VIEW)
+            switch (socketEvent.second)
             {
-                string playerDescString{ FetchPlayerDescAsString(playerID) };
-                if(playerDescString.empty())
+            case SocketEvent::IdleTimeout:
+                socketInfo->idleTimer = INVALID_TIMER;
+                if (!socketInfo->subscribedPlayers.empty())
                 {
-                    CopyStringToWriteBuffer("Unable to find player ID " + playerID, socketInfo);
+                    // watchers are quiet by design, the keepalive finds out if they've gone
+                    ArmSocketTimer(timers, socketEvents, socketInfo->idleTimer, socketInfo->socket, SocketEvent::IdleTimeout, IDLE_CONNECTION_TIMEOUT_MS);
                 }
                 else
                 {
-                    CopyStringToWriteBuffer(playerDescString, socketInfo);
-                }
-            }
-            else if(controlCode == STR || controlCode == INT)
-            {
-                PlayerDesc playerDesc;
-                if (GetPlayerDesc(playerID, playerDesc))
-                {
-                    int attrValue;
-                    string attrKey;
-                    if (controlCode == STR)
-                    {
-                        attrValue = playerDesc.strength;
-                        attrKey = DATA_KEY_STRENGTH;
-                    }
-                    else
-                    {
-                        attrValue = playerDesc.intellect;
-                        attrKey = DATA_KEY_INTELLECT;
-                    }
-                    ++attrValue;    // demo just adjusts by 1
-                    if (SetPlayerAttribueValue(playerID, attrKey, attrValue))
-                    {
-                        stringstream outstr;
-                        outstr << "Attribute " << attrKey << " increased to " << attrValue;
-                        CopyStringToWriteBuffer(outstr.str(), socketInfo);
-                    }
-                    else
-                    {
-                        CopyStringToWriteBuffer("Unable to adjust player attribute value for " + attrKey, socketInfo);
-                    }
+                    cout << "Closing idle connection " << socketInfo->connectionID << endl;
+                    socketsToFree.push_back(*socketInfo);
                 }
-                else
+                break;
+
+            case SocketEvent::SendTimeout:
+                socketInfo->sendTimer = INVALID_TIMER;
+                cout << "Connection " << socketInfo->connectionID << " stopped taking its replies, closing it" << endl;
+                socketsToFree.push_back(*socketInfo);
+                break;
+
+            case SocketEvent::Keepalive:
+                // anything already queued does the same job
+                if (socketInfo->bytesSEND == 0 && socketInfo->pushQueue.empty())
                 {
-                    CopyStringToWriteBuffer("Unable to find player ID " + playerID, socketInfo);
+                    socketInfo->pushQueue.push_back(KEEPALIVE_MESSAGE);
                 }
-            }
-            else
-            {
-                CopyStringToWriteBuffer("Invalid control code sent to server", socketInfo);
+                break;
             }
         }
+        socketEvents.clear();
     }
 
-    void FreeSockets(vector<SocketInformation>& socketList, const vector<SocketInformation>& socketsToFree)
+    void FreeSockets(vector<SocketInformation>& socketList, const vector<SocketInformation>& socketsToFree, TimerWheel& timers)
     {
+        vector<SOCKET> closedSockets;
         for (const SocketInformation& socketToFree : socketsToFree)
         {
-            socketList.erase(std::remove_if(socketList.begin(), socketList.end(), [socketToFree](const SocketInformation& info) {
-                return info.socket == socketToFree.socket;
-            }), socketList.end());
+            // a socket can be freed for more than one reason in the same tick
+            if (find(closedSockets.begin(), closedSockets.end(), socketToFree.socket) != closedSockets.end())
+            {
+                continue;
+            }
+            closedSockets.push_back(socketToFree.socket);
+
+            // socketsToFree holds copies, the timers and subscriptions may have changed since
+            auto socketInfo{ find_if(socketList.begin(), socketList.end(),
+                [&socketToFree](const SocketInformation& curSocket) { return curSocket.socket == socketToFree.socket; }) };
+            if (socketInfo != socketList.end())
+            {
+                for (const string& playerID : socketInfo->subscribedPlayers)
+                {
+                    RemoveSubscription(playerID, socketInfo->socket);
+                }
+                DisarmSocketTimer(timers, socketInfo->idleTimer);
+                DisarmSocketTimer(timers, socketInfo->sendTimer);
+                DisarmSocketTimer(timers, socketInfo->keepaliveTimer);
+                StopInventoryListing(*socketInfo);
+            }
+            closesocket(socketToFree.socket);
         }
+        RemoveConnections(socketList, socketsToFree);
     }
 
-    bool RunSocketServerLoop()
+    bool RunSocketServerLoop(u_short port = PORT)
     {
         cout << "Starting socket server" << endl;
         WSADATA wsaData;
@@ -497,7 +1706,7 @@ namespace AmazingRPG
         SOCKADDR_IN internetAddr;
         internetAddr.sin_family = AF_INET;
         internetAddr.sin_addr.s_addr = htonl(INADDR_ANY);
-        internetAddr.sin_port = htons(PORT);
+        internetAddr.sin_port = htons(port);
 
         if (::bind(listenSocket, reinterpret_cast<LPSOCKADDR>(&internetAddr), static_cast<int>(sizeof(internetAddr))) == SOCKET_ERROR)
         {
@@ -525,7 +1734,7 @@ namespace AmazingRPG
             return true;
         }
 
-        cout << "Listening on port " + PORT << endl;
+        cout << "Listening on port " << port << endl;
 
         bool running = true;
         SOCKET acceptSocket;
@@ -533,14 +1742,33 @@ namespace AmazingRPG
         FD_SET readSet;
         int total;
         DWORD flags;
-        DWORD sendBytes;
         DWORD recvBytes;
         vector<SocketInformation> socketList;
+        uint32_t nextConnectionID{ 0 };
+        // connection IDs start again, so reads left over from an earlier run mustn't match them
+        s_inventoryQueries.clear();
+
+        // connection timeouts and periodic jobs all run off one timer wheel, select
+        // sleeps until the next timer is due rather than polling
+        TimerWheel timers{ chrono::milliseconds{ TIMER_TICK_MS }, chrono::steady_clock::now() };
+        SocketEventList socketEvents;
+        timers.ScheduleRepeating(chrono::milliseconds{ STATS_REPORT_INTERVAL_MS }, []
+        {
+            ReportHedgeStats();
+            ReportClusterStats();
+            ReportHotKeyStats();
+            ReportPlayerFilterStats();
+        });
+        timers.ScheduleRepeating(chrono::milliseconds{ TRACE_FLUSH_INTERVAL_MS }, []
+        {
+            if (s_traceWriter.IsOpen())
+            {
+                s_traceWriter.Flush();
+            }
+        });
 
         while (running)
         {
-            Sleep(500);
-
             ZeroMemory(&readSet, sizeof(readSet));
             ZeroMemory(&writeSet, sizeof(writeSet));
 
@@ -548,11 +1776,19 @@ namespace AmazingRPG
 
             for (const SocketInformation& socketInfo : socketList)
             {
-                FD_SET(socketInfo.socket, &writeSet);
+                // sockets are nearly always writable, so only ask when there's something to write
+                if (socketInfo.bytesSEND > 0 || !socketInfo.pushQueue.empty())
+                {
+                    FD_SET(socketInfo.socket, &writeSet);
+                }
                 FD_SET(socketInfo.socket, &readSet);
             }
-            
-            total = select(0, &readSet, &writeSet, nullptr, nullptr);
+
+            // inventory page reads don't wake select when they finish, so look for them every tick
+            const chrono::milliseconds maxSelectWait{ s_inventoryQueries.empty() ? MAX_SELECT_WAIT_MS : TIMER_TICK_MS };
+            auto untilNextTimer{ timers.GetTimeUntilNextTimer(chrono::steady_clock::now(), maxSelectWait) };
+            timeval selectTimeout{ static_cast<long>(untilNextTimer.count() / 1000), static_cast<long>(untilNextTimer.count() % 1000 * 1000) };
+            total = select(0, &readSet, &writeSet, nullptr, &selectTimeout);
             if (total == SOCKET_ERROR)
             {
                 std::cout << "select error " << WSAGetLastError() << std::endl;
@@ -561,6 +1797,8 @@ namespace AmazingRPG
                 return true;
             }
 
+            timers.Advance(chrono::steady_clock::now());
+
             // check for new connections on the listening socket
             if (FD_ISSET(listenSocket, &readSet))
             {
@@ -579,6 +1817,8 @@ namespace AmazingRPG
                     }
                     SocketInformation socketInfo;
                     socketInfo.socket = acceptSocket;
+                    socketInfo.connectionID = nextConnectionID++;
+                    ArmSocketTimer(timers, socketEvents, socketInfo.idleTimer, acceptSocket, SocketEvent::IdleTimeout, IDLE_CONNECTION_TIMEOUT_MS);
                     socketList.push_back(socketInfo);
                 }
                 else
@@ -594,6 +1834,8 @@ namespace AmazingRPG
             }
 
             vector<SocketInformation> socketsToFree;
+            HandleSocketEvents(socketList, socketEvents, timers, socketsToFree);
+
             // check each socket for a read and write notification until each socket with a notification
             // has been dealt with (total contains the number of sockets with read or write notificatons)
             for (SocketInformation& socketInfo : socketList)
@@ -616,53 +1858,204 @@ namespace AmazingRPG
                     else
                     {
                         socketInfo.bytesRECV = recvBytes;
+                        socketInfo.requestDeadline = MakeDeadline();
+                        if (s_traceWriter.IsOpen() && recvBytes > 0)
+                        {
+                            s_traceWriter.Write(socketInfo.connectionID, socketInfo.readBuffer, recvBytes);
+                        }
                         if (recvBytes == 0)
                         {
                             // zero bytes read indicates client closed connection
                             socketsToFree.push_back(socketInfo);
                         }
+                        else
+                        {
+                            ArmSocketTimer(timers, socketEvents, socketInfo.idleTimer, socketInfo.socket, SocketEvent::IdleTimeout, IDLE_CONNECTION_TIMEOUT_MS);
+                        }
                     }
                 }
 
                 // if we read something from the socket, act on the read and determine what to write
                 ProcessSocket(socketInfo);
+                socketInfo.bytesRECV = 0;
+
+                if (!socketInfo.subscribedPlayers.empty() && socketInfo.keepaliveTimer == INVALID_TIMER)
+                {
+                    ArmSocketTimer(timers, socketEvents, socketInfo.keepaliveTimer, socketInfo.socket, SocketEvent::Keepalive, CLIENT_KEEPALIVE_INTERVAL_MS);
+                }
+                else if (socketInfo.subscribedPlayers.empty() && socketInfo.keepaliveTimer != INVALID_TIMER)
+                {
+                    DisarmSocketTimer(timers, socketInfo.keepaliveTimer);
+                }
+            }
+
+            // stat changes from this tick go out to subscribers together
+            FlushPlayerDeltas(socketList);
+            StreamInventoryPages(socketList);
 
+            for (SocketInformation& socketInfo : socketList)
+            {
                 // Anything to write yet?
-                if (socketInfo.bytesSEND > 0)
+                if ((socketInfo.bytesSEND > 0 || !socketInfo.pushQueue.empty()) && FD_ISSET(socketInfo.socket, &writeSet))
                 {
-                    if (FD_ISSET(socketInfo.socket, &writeSet))
+                    --total;
+                    // the client is taking data, so it gets a fresh send timeout
+                    DisarmSocketTimer(timers, socketInfo.sendTimer);
+                    if (!SendPendingData(socketInfo))
                     {
-                        --total;
-                        socketInfo.dataBuffer.buf = socketInfo.writeBuffer;
-                        socketInfo.dataBuffer.len = socketInfo.bytesSEND;
-                        if (WSASend(socketInfo.socket, &(socketInfo.dataBuffer), 1, &sendBytes, 0, nullptr, nullptr) == SOCKET_ERROR)
-                        {
-                            if (WSAGetLastError() != WSAEWOULDBLOCK)
-                            {
-                                std::cout << "Socket write error, closing socket due to error " << WSAGetLastError() << std::endl;
-                                socketsToFree.push_back(socketInfo);
-                            }
-                            else
-                            {
-                                socketInfo.bytesSEND = 0;
-                            }
-                        }
+                        socketsToFree.push_back(socketInfo);
                     }
                 }
+
+                bool hasPendingData{ socketInfo.bytesSEND > 0 || !socketInfo.pushQueue.empty() };
+                if (hasPendingData && socketInfo.sendTimer == INVALID_TIMER)
+                {
+                    ArmSocketTimer(timers, socketEvents, socketInfo.sendTimer, socketInfo.socket, SocketEvent::SendTimeout, SEND_TIMEOUT_MS);
+                }
+                else if (!hasPendingData && socketInfo.sendTimer != INVALID_TIMER)
+                {
+                    DisarmSocketTimer(timers, socketInfo.sendTimer);
+                }
             }
 
-            FreeSockets(socketList, socketsToFree);
+            FreeSockets(socketList, socketsToFree, timers);
         }
 
         return true;
     }
     
+    // Records every frame the server receives so it can be played back with GameReplay
+    bool RunSocketServerLoopWithCapture()
+    {
+        cout << "File to record traffic to: ";
+        string fileName;
+        cin >> fileName;
+        if (!s_traceWriter.Open(fileName))
+        {
+            cout << "Unable to open " << fileName << " for writing" << endl;
+            return true;
+        }
+
+        cout << "Recording traffic to " << fileName << endl;
+        bool keepRunning{ RunSocketServerLoop() };
+        // stop recording, the plain server loop can be run from the menu afterwards
+        s_traceWriter.Close();
+        return keepRunning;
+    }
+
+    // Serves players from memory so replays measure the server and not DynamoDB
+    bool RunSocketServerLoopInMemory()
+    {
+        cout << "How many players should the in-memory store hold? ";
+        int playerCount{ 0 };
+        cin >> playerCount;
+        if (cin.fail() || playerCount <= 0)
+        {
+            cin.clear();
+            cin.ignore(numeric_limits<streamsize>::max(), '\n');
+            cout << "You didn't enter a positive integer" << endl;
+            return true;
+        }
+
+        PlayerGeneratorSettings settings;
+        settings.seed = IN_MEMORY_PLAYER_SEED;
+        PlayerColumns players;
+        players.Resize(playerCount);
+        GeneratePlayers(settings, players);
+        s_inMemoryPlayers.Populate(players);
+        s_useInMemoryStorage = true;
+
+        // the store holds every player there is, so unknown IDs never need a lookup. Any
+        // filter built from DynamoDB is set aside and put back afterwards
+        PlayerExistenceFilter inMemoryFilter{ PLAYER_FILTER_MAX_BITMAP_ID, PLAYER_FILTER_EXPECTED_PLAYERS, PLAYER_FILTER_FALSE_POSITIVE_RATE };
+        for (size_t playerIdx{ 0 }; playerIdx < players.count; ++playerIdx)
+        {
+            inMemoryFilter.Add(players.GetPlayerDesc(playerIdx).id);
+        }
+        // inMemoryFilter holds the filter that was in use until they're swapped back
+        s_playerFilter.Swap(inMemoryFilter);
+        const bool savedUsePlayerFilter{ s_usePlayerFilter };
+        s_usePlayerFilter = true;
+
+        cout << "Serving " << playerCount << " players from memory" << endl;
+        bool keepRunning{ RunSocketServerLoop() };
+        // back to DynamoDB and whatever filter was in use before
+        s_useInMemoryStorage = false;
+        s_playerFilter.Swap(inMemoryFilter);
+        s_usePlayerFilter = savedUsePlayerFilter;
+        return keepRunning;
+    }
+
+    void ResetClusterNode()
+    {
+        s_localNode = nullptr;
+        s_clusterRing.SetNodes({});
+        s_ownedRequests = 0;
+        s_redirectedRequests = 0;
+    }
+
+    // Runs as one node of a cluster, players are split between the nodes by a
+    // consistent hash of their ID and requests for other nodes' players are redirected
+    bool RunSocketServerLoopAsClusterNode()
+    {
+        cout << "Cluster config file: ";
+        string configFileName;
+        cin >> configFileName;
+
+        vector<ClusterNode> nodes;
+        string error;
+        if (!LoadClusterConfig(configFileName, nodes, error))
+        {
+            cout << error << endl;
+            return true;
+        }
+        // s_localNode points into the ring's nodes, which SetNodes replaces
+        ResetClusterNode();
+        s_clusterRing.SetNodes(nodes);
+
+        cout << "Which node is this server? ";
+        string nodeName;
+        cin >> nodeName;
+        s_localNode = s_clusterRing.FindNode(nodeName);
+        if (s_localNode == nullptr)
+        {
+            cout << "There's no node called " << nodeName << " in " << configFileName << endl;
+            ResetClusterNode();
+            return true;
+        }
+
+        // show how evenly the ring splits players so a bad config is obvious up front
+        const int SAMPLE_PLAYER_COUNT{ 100000 };
+        map<string, int> ownedCounts;
+        for (int playerIdx{ 0 }; playerIdx < SAMPLE_PLAYER_COUNT; ++playerIdx)
+        {
+            ++ownedCounts[s_clusterRing.GetOwner(GetPlayerIDForInt(playerIdx))->name];
+        }
+        for (const ClusterNode& node : s_clusterRing.GetNodes())
+        {
+            cout << "\t" << node.name << " (" << node.host << ":" << node.port << ") owns "
+                 << fixed << setprecision(1) << 100.0 * ownedCounts[node.name] / SAMPLE_PLAYER_COUNT << "% of players" << endl;
+        }
+        cout.unsetf(ios_base::floatfield);
+        cout << setprecision(6);
+
+        bool keepRunning{ RunSocketServerLoop(s_localNode->port) };
+        // the plain server loop owns every player again
+        ResetClusterNode();
+        return keepRunning;
+    }
+
     bool Menu()
     {
         cout << endl << "What would you like to do?" << endl;
         cout << "\t1. Player info (goes to a new menu)" << endl;
         cout << "\t2. Run socket server loop" << endl;
+        cout << "\t3. Run socket server loop and record traffic" << endl;
+        cout << "\t4. Run socket server loop with in-memory storage (for replays)" << endl;
+        cout << "\t5. Run socket server loop as a cluster node" << endl;
+        cout << "\t6. Benchmark DynamoDB client configurations" << endl;
         cout << "\t7. Populate database with fake players" << endl;
+        cout << "\t8. Generate synthetic players for load testing" << endl;
         cout << "\t9. Quit" << endl;
         cout << endl << "Your choice? ";
 
@@ -681,11 +2074,28 @@ namespace AmazingRPG
         
         case 2:
             return RunSocketServerLoop();
+
+        case 3:
+            return RunSocketServerLoopWithCapture();
+
+        case 4:
+            return RunSocketServerLoopInMemory();
+
+        case 5:
+            return RunSocketServerLoopAsClusterNode();
         
+        case 6:
+            BenchmarkClientConfigurations();
+            break;
+
         case 7:
             PopulateDatabases();
             break;
 
+        case 8:
+            GenerateSyntheticPlayers();
+            break;
+
         case 9:
             return false;
 
@@ -699,10 +2109,10 @@ namespace AmazingRPG
     {
         cout << "Welcome to The Game!" << endl;
 
+        // the socket server loop waits on its own sockets and timers, so there's
+        // nothing to check between menu choices
         while (Menu())
         {
-            //TODO check for reads in here
-            std::this_thread::sleep_for(std::chrono::seconds(0));
         }
         return 0;
     }
@@ -718,12 +2128,20 @@ int main()
 
     Aws::InitAPI(options);
 
-    Aws::Client::ClientConfiguration clientConfig;
-	clientConfig.region = AmazingRPG::REGION;
-    AmazingRPG::s_DynamoDBClient = Aws::MakeShared<Aws::DynamoDB::DynamoDBClient>("DyanmoDBClient", clientConfig);
+    AmazingRPG::s_DynamoDBClientPool = make_unique<AmazingRPG::DynamoDBClientPool>(AmazingRPG::DynamoDBClientSettings{});
+    AmazingRPG::s_DynamoDBClient = AmazingRPG::s_DynamoDBClientPool->GetClient(0);
+    AmazingRPG::s_inventoryClientPool = make_unique<AmazingRPG::DynamoDBClientPool>(AmazingRPG::MakeInventoryClientSettings());
+    AmazingRPG::s_inventoryClient = AmazingRPG::s_inventoryClientPool->GetClient(0);
 
     exitStatus = AmazingRPG::RunMainLoop();
 
+    // the clients have to go before the SDK shuts down
+    AmazingRPG::s_inventoryQueries.clear();
+    AmazingRPG::s_inventoryClient.reset();
+    AmazingRPG::s_inventoryClientPool.reset();
+    AmazingRPG::s_DynamoDBClient.reset();
+    AmazingRPG::s_DynamoDBClientPool.reset();
+
     Aws::ShutdownAPI(options);
     return exitStatus;
 }
\ No newline at end of file
@@ -0,0 +1,107 @@
+#pragma once
+// Standard library
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <vector>
+
+namespace AmazingRPG
+{
+    using Deadline = std::chrono::steady_clock::time_point;
+
+    //////////////////////////////////////////////////////////////////////////////
+    // Keeps the most recent latencies so the hedge delay follows what DynamoDB
+    // is actually doing right now rather than a fixed number
+    class LatencyTracker
+    {
+    public:
+        explicit LatencyTracker(size_t sampleCount = 512)
+            : m_samples(sampleCount, 0.0)
+        {
+        }
+
+        void Record(std::chrono::duration<double, std::milli> latency)
+        {
+            std::lock_guard<std::mutex> lock{ m_mutex };
+            m_samples[m_nextSample] = latency.count();
+            m_nextSample = (m_nextSample + 1) % m_samples.size();
+            m_sampleCount = std::min(m_sampleCount + 1, m_samples.size());
+        }
+
+        // returns fallback until we've seen enough samples to trust the percentile
+        std::chrono::duration<double, std::milli> GetPercentile(double percentile, std::chrono::duration<double, std::milli> fallback) const
+        {
+            std::vector<double> samples;
+            {
+                std::lock_guard<std::mutex> lock{ m_mutex };
+                if (m_sampleCount < MIN_SAMPLES)
+                {
+                    return fallback;
+                }
+                samples.assign(m_samples.begin(), m_samples.begin() + m_sampleCount);
+            }
+
+            size_t index{ static_cast<size_t>(percentile / 100.0 * (samples.size() - 1)) };
+            std::nth_element(samples.begin(), samples.begin() + index, samples.end());
+            return std::chrono::duration<double, std::milli>{ samples[index] };
+        }
+
+    private:
+        static const size_t MIN_SAMPLES{ 20 };
+
+        mutable std::mutex m_mutex;
+        std::vector<double> m_samples;
+        size_t m_nextSample{ 0 };
+        size_t m_sampleCount{ 0 };
+    };
+
+    //////////////////////////////////////////////////////////////////////////////
+    // Token bucket that caps hedges to a fraction of reads. Every read earns
+    // ratio tokens and every hedge spends one, so when DynamoDB is slow across
+    // the board we can't double our own load and make things worse
+    class HedgeBudget
+    {
+    public:
+        HedgeBudget(double ratio, double maxTokens)
+            : m_ratio{ ratio }
+            , m_maxTokens{ maxTokens }
+            , m_tokens{ maxTokens }
+        {
+        }
+
+        void OnRead()
+        {
+            std::lock_guard<std::mutex> lock{ m_mutex };
+            m_tokens = std::min(m_tokens + m_ratio, m_maxTokens);
+        }
+
+        bool TrySpend()
+        {
+            std::lock_guard<std::mutex> lock{ m_mutex };
+            if (m_tokens < 1.0)
+            {
+                return false;
+            }
+            m_tokens -= 1.0;
+            return true;
+        }
+
+    private:
+        std::mutex m_mutex;
+        const double m_ratio;
+        const double m_maxTokens;
+        double m_tokens;
+    };
+
+    struct HedgeStats
+    {
+        std::atomic<long long> reads{ 0 };
+        std::atomic<long long> hedgesSent{ 0 };
+        // the hedge answered before the original request
+        std::atomic<long long> hedgeWins{ 0 };
+        // wanted to hedge but the budget was empty
+        std::atomic<long long> hedgesDenied{ 0 };
+        std::atomic<long long> deadlineMisses{ 0 };
+    };
+}
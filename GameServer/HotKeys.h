@@ -0,0 +1,282 @@
+#pragma once
+// Standard library
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Project includes
+#include "../Common/common.h"
+
+namespace AmazingRPG
+{
+    //////////////////////////////////////////////////////////////////////////////
+    // Count-min sketch, estimates how often each key was seen in fixed memory.
+    // Estimates can be too high when keys share counters but never too low
+    class CountMinSketch
+    {
+    public:
+        CountMinSketch(size_t width, size_t depth)
+            : m_width{ std::max<size_t>(1, width) }
+            , m_depth{ std::max<size_t>(1, depth) }
+            , m_counts(m_width * m_depth, 0)
+        {
+        }
+
+        // counts the key once and returns its new estimate
+        uint32_t Add(const std::string& key)
+        {
+            const uint64_t hash{ HashKey(key) };
+            uint32_t estimate{ UINT32_MAX };
+            for (size_t row{ 0 }; row < m_depth; ++row)
+            {
+                uint32_t& count{ m_counts[GetIndex(row, hash)] };
+                if (count < UINT32_MAX)
+                {
+                    ++count;
+                }
+                estimate = std::min(estimate, count);
+            }
+            return estimate;
+        }
+
+        uint32_t Estimate(const std::string& key) const
+        {
+            const uint64_t hash{ HashKey(key) };
+            uint32_t estimate{ UINT32_MAX };
+            for (size_t row{ 0 }; row < m_depth; ++row)
+            {
+                estimate = std::min(estimate, m_counts[GetIndex(row, hash)]);
+            }
+            return estimate;
+        }
+
+        // ages every count so the sketch follows recent traffic
+        void Halve()
+        {
+            for (uint32_t& count : m_counts)
+            {
+                count >>= 1;
+            }
+        }
+
+    private:
+        // each row picks its own counter from the two halves of the hash (double hashing)
+        size_t GetIndex(size_t row, uint64_t hash) const
+        {
+            const uint64_t first{ hash & 0xFFFFFFFFull };
+            const uint64_t second{ (hash >> 32) | 1 };
+            return row * m_width + static_cast<size_t>((first + row * second) % m_width);
+        }
+
+        size_t m_width;
+        size_t m_depth;
+        std::vector<uint32_t> m_counts;
+    };
+
+    struct HotKey
+    {
+        std::string key;
+        uint32_t count{ 0 };
+    };
+
+    //////////////////////////////////////////////////////////////////////////////
+    // Finds the most requested keys as requests stream past. The sketch counts
+    // every key and the top K by estimate are kept by name. A key is hot while it
+    // is in the top K with at least hotThreshold requests. Every decayInterval
+    // requests all counts are halved, so a player stops being hot once the crowd leaves
+    class HotKeyDetector
+    {
+    public:
+        HotKeyDetector(size_t sketchWidth, size_t sketchDepth, size_t topKeyCount, uint32_t hotThreshold, uint64_t decayInterval)
+            : m_sketch{ sketchWidth, sketchDepth }
+            , m_topKeyCount{ std::max<size_t>(1, topKeyCount) }
+            , m_hotThreshold{ hotThreshold }
+            , m_decayInterval{ std::max<uint64_t>(1, decayInterval) }
+        {
+        }
+
+        // returns true if the key is hot once this request is counted
+        bool Record(const std::string& key)
+        {
+            std::lock_guard<std::mutex> lock{ m_mutex };
+            UpdateTopKeys(key, m_sketch.Add(key));
+            if (++m_requestsSinceDecay >= m_decayInterval)
+            {
+                Decay();
+            }
+            return IsHotLocked(key);
+        }
+
+        bool IsHot(const std::string& key) const
+        {
+            std::lock_guard<std::mutex> lock{ m_mutex };
+            return IsHotLocked(key);
+        }
+
+        // the current hot keys, most requested first
+        std::vector<HotKey> GetHotKeys() const
+        {
+            std::vector<HotKey> hotKeys;
+            {
+                std::lock_guard<std::mutex> lock{ m_mutex };
+                for (const auto& topKey : m_topKeys)
+                {
+                    if (topKey.second >= m_hotThreshold)
+                    {
+                        hotKeys.push_back({ topKey.first, topKey.second });
+                    }
+                }
+            }
+            std::sort(hotKeys.begin(), hotKeys.end(), [](const HotKey& lhs, const HotKey& rhs) { return lhs.count > rhs.count; });
+            return hotKeys;
+        }
+
+    private:
+        // the top K is small, so a linear scan for the smallest entry is cheaper than a heap
+        void UpdateTopKeys(const std::string& key, uint32_t estimate)
+        {
+            auto topKey{ m_topKeys.find(key) };
+            if (topKey != m_topKeys.end())
+            {
+                topKey->second = estimate;
+                return;
+            }
+
+            if (m_topKeys.size() < m_topKeyCount)
+            {
+                m_topKeys.emplace(key, estimate);
+                return;
+            }
+
+            auto smallest{ std::min_element(m_topKeys.begin(), m_topKeys.end(),
+                [](const std::pair<const std::string, uint32_t>& lhs, const std::pair<const std::string, uint32_t>& rhs) { return lhs.second < rhs.second; }) };
+            if (estimate > smallest->second)
+            {
+                m_topKeys.erase(smallest);
+                m_topKeys.emplace(key, estimate);
+            }
+        }
+
+        void Decay()
+        {
+            m_sketch.Halve();
+            for (auto topKey{ m_topKeys.begin() }; topKey != m_topKeys.end();)
+            {
+                topKey->second >>= 1;
+                topKey = topKey->second == 0 ? m_topKeys.erase(topKey) : std::next(topKey);
+            }
+            m_requestsSinceDecay = 0;
+        }
+
+        bool IsHotLocked(const std::string& key) const
+        {
+            auto topKey{ m_topKeys.find(key) };
+            return topKey != m_topKeys.end() && topKey->second >= m_hotThreshold;
+        }
+
+        mutable std::mutex m_mutex;
+        CountMinSketch m_sketch;
+        std::unordered_map<std::string, uint32_t> m_topKeys;
+        const size_t m_topKeyCount;
+        const uint32_t m_hotThreshold;
+        const uint64_t m_decayInterval;
+        uint64_t m_requestsSinceDecay{ 0 };
+    };
+
+    //////////////////////////////////////////////////////////////////////////////
+    // Pinned copies of hot players, so a crowd watching one player doesn't turn
+    // into a stream of reads against a single DynamoDB partition. Copies expire
+    // after a short time to pick up changes made by other servers, changes made
+    // by this server are applied to the copy straight away. Requests are handled
+    // one at a time on the server loop, so there are never two reads of the same
+    // player in flight to collapse into one
+    class HotPlayerCache
+    {
+    public:
+        explicit HotPlayerCache(std::chrono::milliseconds timeToLive)
+            : m_timeToLive{ timeToLive }
+        {
+        }
+
+        bool Get(const std::string& ID, PlayerDesc& playerDesc)
+        {
+            std::lock_guard<std::mutex> lock{ m_mutex };
+            auto pinned{ m_pinned.find(ID) };
+            if (pinned == m_pinned.end())
+            {
+                return false;
+            }
+            if (std::chrono::steady_clock::now() >= pinned->second.expiry)
+            {
+                m_pinned.erase(pinned);
+                return false;
+            }
+            playerDesc = pinned->second.playerDesc;
+            return true;
+        }
+
+        void Pin(const PlayerDesc& playerDesc)
+        {
+            std::lock_guard<std::mutex> lock{ m_mutex };
+            m_pinned[playerDesc.id] = { playerDesc, std::chrono::steady_clock::now() + m_timeToLive };
+        }
+
+        // keeps a pinned copy in step with this server's writes, unpinned players are left alone
+        void UpdateStat(const std::string& ID, char fieldCode, int newValue, unsigned long long newVersion)
+        {
+            std::lock_guard<std::mutex> lock{ m_mutex };
+            auto pinned{ m_pinned.find(ID) };
+            if (pinned == m_pinned.end())
+            {
+                return;
+            }
+            if (fieldCode == STR)
+            {
+                pinned->second.playerDesc.strength = newValue;
+                pinned->second.playerDesc.version = newVersion;
+            }
+            else if (fieldCode == INT)
+            {
+                pinned->second.playerDesc.intellect = newValue;
+                pinned->second.playerDesc.version = newVersion;
+            }
+            else
+            {
+                // we don't know how to apply it, so make the next read fetch the player
+                m_pinned.erase(pinned);
+            }
+        }
+
+        size_t GetPinnedCount() const
+        {
+            std::lock_guard<std::mutex> lock{ m_mutex };
+            return m_pinned.size();
+        }
+
+    private:
+        struct PinnedPlayer
+        {
+            PlayerDesc playerDesc;
+            std::chrono::steady_clock::time_point expiry;
+        };
+
+        mutable std::mutex m_mutex;
+        const std::chrono::milliseconds m_timeToLive;
+        std::unordered_map<std::string, PinnedPlayer> m_pinned;
+    };
+
+    struct HotKeyStats
+    {
+        // requests counted by the detector
+        std::atomic<long long> requests{ 0 };
+        // hot player reads answered from a pinned copy
+        std::atomic<long long> pinnedHits{ 0 };
+        // hot player reads that went to DynamoDB
+        std::atomic<long long> backendReads{ 0 };
+    };
+}
@@ -0,0 +1,111 @@
+#pragma once
+// Standard library
+#include <climits>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+// Project includes
+#include "../Common/common.h"
+#include "PlayerGenerator.h"
+
+namespace AmazingRPG
+{
+    enum class StatChange
+    {
+        Applied,
+        PlayerNotFound,
+        // the change would take the stat outside an int
+        OutOfRange,
+    };
+
+    //////////////////////////////////////////////////////////////////////////////
+    // Stands in for the PlayerData table when replaying traffic, so replays measure
+    // the server rather than DynamoDB and two runs see exactly the same data.
+    // Stats are addressed by protocol field code (STR, INT)
+    class InMemoryPlayerStore
+    {
+    public:
+        void Populate(const PlayerColumns& players)
+        {
+            std::lock_guard<std::mutex> lock{ m_mutex };
+            m_players.clear();
+            m_players.reserve(players.count);
+            for (size_t row{ 0 }; row < players.count; ++row)
+            {
+                PlayerDesc playerDesc{ players.GetPlayerDesc(row) };
+                m_players[playerDesc.id] = playerDesc;
+            }
+        }
+
+        bool Get(const std::string& ID, PlayerDesc& playerDesc) const
+        {
+            std::lock_guard<std::mutex> lock{ m_mutex };
+            auto player{ m_players.find(ID) };
+            if (player == m_players.end())
+            {
+                return false;
+            }
+            playerDesc = player->second;
+            return true;
+        }
+
+        // writes bump the player's version, the same as they do in DynamoDB
+        bool SetStat(const std::string& ID, char fieldCode, int newValue, unsigned long long& newVersion)
+        {
+            std::lock_guard<std::mutex> lock{ m_mutex };
+            PlayerDesc* player{ nullptr };
+            int* stat{ FindStat(ID, fieldCode, player) };
+            if (stat == nullptr)
+            {
+                return false;
+            }
+            *stat = newValue;
+            newVersion = ++player->version;
+            return true;
+        }
+
+        // the same checks as a DynamoDB grant, the player has to exist and the stat stays within an int
+        StatChange AddToStat(const std::string& ID, char fieldCode, int amount, int& newValue, unsigned long long& newVersion)
+        {
+            std::lock_guard<std::mutex> lock{ m_mutex };
+            PlayerDesc* player{ nullptr };
+            int* stat{ FindStat(ID, fieldCode, player) };
+            if (stat == nullptr)
+            {
+                return StatChange::PlayerNotFound;
+            }
+            if ((amount > 0 && *stat > INT_MAX - amount) || (amount < 0 && *stat < INT_MIN - amount))
+            {
+                return StatChange::OutOfRange;
+            }
+            *stat += amount;
+            newValue = *stat;
+            newVersion = ++player->version;
+            return StatChange::Applied;
+        }
+
+    private:
+        int* FindStat(const std::string& ID, char fieldCode, PlayerDesc*& player)
+        {
+            auto playerEntry{ m_players.find(ID) };
+            if (playerEntry == m_players.end())
+            {
+                return nullptr;
+            }
+            player = &playerEntry->second;
+            if (fieldCode == STR)
+            {
+                return &player->strength;
+            }
+            if (fieldCode == INT)
+            {
+                return &player->intellect;
+            }
+            return nullptr;
+        }
+
+        mutable std::mutex m_mutex;
+        std::unordered_map<std::string, PlayerDesc> m_players;
+    };
+}
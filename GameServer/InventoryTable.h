@@ -0,0 +1,157 @@
+#pragma once
+// Standard library
+#include <climits>
+#include <iomanip>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// AWS C++ SDK
+#include <aws/dynamodb/model/AttributeValue.h>
+#include <aws/dynamodb/model/BatchWriteItemRequest.h>
+#include <aws/dynamodb/model/PutRequest.h>
+#include <aws/dynamodb/model/QueryRequest.h>
+#include <aws/dynamodb/model/WriteRequest.h>
+
+// Project includes
+#include "../Common/common.h"
+#include "PlayerTable.h"
+
+namespace AmazingRPG
+{
+    //////////////////////////////////////////////////////////////////////////////
+    // inventory keys
+    // Every player's items share the player's partition key (DATA_KEY_ID) and are
+    // sorted by item ID, so one player's inventory is read a page at a time with Query
+    const std::string INVENTORY_TABLE_NAME{ "PlayerInventory" };
+    const std::string INVENTORY_KEY_ITEM_ID{ "ItemID" };
+    const std::string INVENTORY_KEY_ITEM_NAME{ "ItemName" };
+    const std::string INVENTORY_KEY_ITEM_COUNT{ "ItemCount" };
+    // longest item ID that still fits in a continuation token next to the player ID
+    const size_t MAX_ITEM_ID_SIZE{ MAX_CONTINUATION_TOKEN_SIZE / 2 - ID_SIZE };
+
+    //////////////////////////////////////////////////////////////////////////////
+    // Building DynamoDB requests for the PlayerInventory table and reading its items
+
+    // zero padded so the sort key order matches the number order
+    inline std::string GetItemIDForInt(int itemNumber)
+    {
+        std::stringstream itemID;
+        itemID << "item" << std::setfill('0') << std::setw(8) << itemNumber;
+        return itemID.str();
+    }
+
+    // At most pageSize items after lastItemID, or from the first item when it's empty.
+    // DynamoDB also stops a page at 1MB, so a page can hold fewer items than asked for
+    inline Aws::DynamoDB::Model::QueryRequest MakeInventoryPageRequest(const std::string& ID, const std::string& lastItemID, int pageSize)
+    {
+        Aws::DynamoDB::Model::QueryRequest queryRequest;
+        queryRequest.SetTableName(INVENTORY_TABLE_NAME);
+        queryRequest.SetKeyConditionExpression(DATA_KEY_ID + " = :id");
+        queryRequest.SetLimit(pageSize);
+
+        Aws::DynamoDB::Model::AttributeValue avID;
+        avID.SetS(ID);
+        std::map<std::string, Aws::DynamoDB::Model::AttributeValue> attributeValues;
+        attributeValues[":id"] = avID;
+        queryRequest.SetExpressionAttributeValues(attributeValues);
+
+        if (!lastItemID.empty())
+        {
+            Aws::DynamoDB::Model::AttributeValue avItemID;
+            avItemID.SetS(lastItemID);
+            std::map<std::string, Aws::DynamoDB::Model::AttributeValue> exclusiveStartKey;
+            exclusiveStartKey[DATA_KEY_ID] = avID;
+            exclusiveStartKey[INVENTORY_KEY_ITEM_ID] = avItemID;
+            queryRequest.SetExclusiveStartKey(exclusiveStartKey);
+        }
+        return queryRequest;
+    }
+
+    // item IDs and names go out between the listing's separators, so they can't hold them
+    inline bool IsListableInventoryText(const std::string& text)
+    {
+        return text.find(PUSH_DELTA_FIELD_END) == std::string::npos && text.find(PUSH_DELTA_END) == std::string::npos;
+    }
+
+    // Items written without a name or count read back as an unnamed single item. False
+    // for items that can't be listed, no ID, a separator in the ID or name or a count
+    // that isn't a non-negative int
+    template <typename Item>
+    bool ReadInventoryItemFromItem(const Item& item, InventoryItem& inventoryItem)
+    {
+        auto itemID{ item.find(INVENTORY_KEY_ITEM_ID) };
+        if (itemID == item.end())
+        {
+            return false;
+        }
+        inventoryItem.itemID = itemID->second.GetS();
+        auto name{ item.find(INVENTORY_KEY_ITEM_NAME) };
+        inventoryItem.name = name == item.end() ? std::string{} : std::string{ name->second.GetS() };
+        if (inventoryItem.itemID.empty() || !IsListableInventoryText(inventoryItem.itemID) || !IsListableInventoryText(inventoryItem.name))
+        {
+            return false;
+        }
+
+        auto count{ item.find(INVENTORY_KEY_ITEM_COUNT) };
+        if (count == item.end())
+        {
+            inventoryItem.count = 1;
+            return true;
+        }
+        long long countValue{ 0 };
+        if (!ParseInteger(count->second.GetN(), 0, INT_MAX, countValue))
+        {
+            return false;
+        }
+        inventoryItem.count = static_cast<int>(countValue);
+        return true;
+    }
+
+    // the item ID a page stopped at, empty if the page was the last one
+    template <typename Key>
+    std::string GetLastItemID(const Key& lastEvaluatedKey)
+    {
+        auto itemID{ lastEvaluatedKey.find(INVENTORY_KEY_ITEM_ID) };
+        return itemID == lastEvaluatedKey.end() ? std::string{} : std::string{ itemID->second.GetS() };
+    }
+
+    // false, with nothing built, if any item couldn't be listed back, see IsListableInventoryText
+    inline bool MakeInventoryChunkWriteRequest(const std::string& ID, const std::vector<InventoryItem>& itemChunk, Aws::DynamoDB::Model::BatchWriteItemRequest& batchWriteRequest)
+    {
+        std::vector<Aws::DynamoDB::Model::WriteRequest> writeRequests;
+        writeRequests.reserve(itemChunk.size());
+        for (const auto& chunkItem : itemChunk)
+        {
+            if (chunkItem.itemID.empty() || chunkItem.itemID.size() > MAX_ITEM_ID_SIZE
+                || !IsListableInventoryText(chunkItem.itemID) || !IsListableInventoryText(chunkItem.name))
+            {
+                return false;
+            }
+
+            Aws::DynamoDB::Model::AttributeValue avID;
+            avID.SetS(ID);
+            Aws::DynamoDB::Model::AttributeValue avItemID;
+            avItemID.SetS(chunkItem.itemID);
+            Aws::DynamoDB::Model::AttributeValue avName;
+            avName.SetS(chunkItem.name);
+            Aws::DynamoDB::Model::AttributeValue avCount;
+            avCount.SetN(std::to_string(chunkItem.count));
+
+            Aws::DynamoDB::Model::PutRequest putRequest;
+            putRequest.AddItem(DATA_KEY_ID, avID);
+            putRequest.AddItem(INVENTORY_KEY_ITEM_ID, avItemID);
+            putRequest.AddItem(INVENTORY_KEY_ITEM_NAME, avName);
+            putRequest.AddItem(INVENTORY_KEY_ITEM_COUNT, avCount);
+
+            Aws::DynamoDB::Model::WriteRequest curWriteRequest;
+            curWriteRequest.SetPutRequest(putRequest);
+            writeRequests.push_back(curWriteRequest);
+        }
+
+        batchWriteRequest = Aws::DynamoDB::Model::BatchWriteItemRequest{};
+        batchWriteRequest.AddRequestItems(INVENTORY_TABLE_NAME, writeRequests);
+        return true;
+    }
+}
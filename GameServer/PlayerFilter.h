@@ -0,0 +1,371 @@
+#pragma once
+// Standard library
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Project includes
+#include "../Common/common.h"
+
+namespace AmazingRPG
+{
+    //////////////////////////////////////////////////////////////////////////////
+    // Missing player filters, saved to file as PLAYER_FILTER_MAGIC followed by
+    //   uint64 player count
+    //   uint64 bitmap word count, then the bitmap words
+    //   uint64 Bloom filter count, then for each filter its bit count, hash count,
+    //   capacity, item count and words
+    // All integers are little endian.
+    const char PLAYER_FILTER_MAGIC[8]{ 'A', 'R', 'P', 'G', 'P', 'F', 'L', '2' };
+
+    namespace PlayerFilterDetail
+    {
+        inline void WriteInt(std::ofstream& file, uint64_t value)
+        {
+            std::string bytes;
+            AppendLittleEndian(bytes, value, 8);
+            file.write(bytes.data(), bytes.size());
+        }
+
+        inline bool ReadInt(std::ifstream& file, uint64_t& value)
+        {
+            char bytes[8];
+            if (!file.read(bytes, sizeof(bytes)))
+            {
+                return false;
+            }
+            value = ReadLittleEndian(bytes, sizeof(bytes));
+            return true;
+        }
+
+        inline void WriteWords(std::ofstream& file, const std::vector<uint64_t>& words)
+        {
+            for (uint64_t word : words)
+            {
+                WriteInt(file, word);
+            }
+        }
+
+        // wordCount comes from the file, so it's checked against a sane limit before allocating
+        inline bool ReadWords(std::ifstream& file, uint64_t wordCount, std::vector<uint64_t>& words)
+        {
+            const uint64_t MAX_WORDS{ 1ull << 28 };
+            if (wordCount > MAX_WORDS)
+            {
+                return false;
+            }
+            words.resize(static_cast<size_t>(wordCount));
+            for (uint64_t& word : words)
+            {
+                if (!ReadInt(file, word))
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////////////
+    // Bloom filter sized for a number of items at a false positive rate. It never
+    // says no to an item that was added, and says yes to others at about that rate.
+    // The bit count is rounded up to a power of two so a bit is picked with a mask
+    class BloomFilter
+    {
+    public:
+        BloomFilter(size_t capacity, double falsePositiveRate)
+            : m_capacity{ std::max<size_t>(1, capacity) }
+        {
+            const double LN2{ 0.6931471805599453 };
+            const double rate{ std::min(std::max(falsePositiveRate, 1e-9), 0.5) };
+            const double bitCount{ std::ceil(-static_cast<double>(m_capacity) * std::log(rate) / (LN2 * LN2)) };
+            m_bitCount = 64;
+            while (m_bitCount < static_cast<uint64_t>(bitCount))
+            {
+                m_bitCount <<= 1;
+            }
+            m_hashCount = std::max<uint64_t>(1, static_cast<uint64_t>(std::round(bitCount / m_capacity * LN2)));
+            m_words.resize(static_cast<size_t>((m_bitCount + 63) / 64));
+        }
+
+        // false if every bit was already set, the item is then counted as added before
+        bool Add(uint64_t hash)
+        {
+            const uint64_t step{ GetStep(hash) };
+            bool setBit{ false };
+            for (uint64_t hashIdx{ 0 }; hashIdx < m_hashCount; ++hashIdx)
+            {
+                const uint64_t bit{ (hash + hashIdx * step) & (m_bitCount - 1) };
+                uint64_t& word{ m_words[static_cast<size_t>(bit / 64)] };
+                const uint64_t mask{ 1ull << (bit % 64) };
+                setBit |= (word & mask) == 0;
+                word |= mask;
+            }
+            if (setBit)
+            {
+                ++m_itemCount;
+            }
+            return setBit;
+        }
+
+        bool MightContain(uint64_t hash) const
+        {
+            const uint64_t step{ GetStep(hash) };
+            for (uint64_t hashIdx{ 0 }; hashIdx < m_hashCount; ++hashIdx)
+            {
+                const uint64_t bit{ (hash + hashIdx * step) & (m_bitCount - 1) };
+                if ((m_words[static_cast<size_t>(bit / 64)] & (1ull << (bit % 64))) == 0)
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        bool IsFull() const { return m_itemCount >= m_capacity; }
+        size_t GetMemoryBytes() const { return m_words.size() * sizeof(uint64_t); }
+
+        void Write(std::ofstream& file) const
+        {
+            PlayerFilterDetail::WriteInt(file, m_bitCount);
+            PlayerFilterDetail::WriteInt(file, m_hashCount);
+            PlayerFilterDetail::WriteInt(file, m_capacity);
+            PlayerFilterDetail::WriteInt(file, m_itemCount);
+            PlayerFilterDetail::WriteWords(file, m_words);
+        }
+
+        bool Read(std::ifstream& file)
+        {
+            uint64_t capacity{ 0 };
+            uint64_t itemCount{ 0 };
+            if (!PlayerFilterDetail::ReadInt(file, m_bitCount) || !PlayerFilterDetail::ReadInt(file, m_hashCount)
+                || !PlayerFilterDetail::ReadInt(file, capacity) || !PlayerFilterDetail::ReadInt(file, itemCount)
+                || m_bitCount < 64 || (m_bitCount & (m_bitCount - 1)) != 0 || m_hashCount == 0 || m_hashCount > 64)
+            {
+                return false;
+            }
+            m_capacity = static_cast<size_t>(capacity);
+            m_itemCount = static_cast<size_t>(itemCount);
+            return PlayerFilterDetail::ReadWords(file, (m_bitCount + 63) / 64, m_words);
+        }
+
+    private:
+        // the second hash for double hashing. It's odd and the bit count is a power
+        // of two, so the probes for one item only repeat after m_bitCount of them
+        static uint64_t GetStep(uint64_t hash)
+        {
+            return ((hash >> 32) | (hash << 32)) | 1;
+        }
+
+        size_t m_capacity;
+        size_t m_itemCount{ 0 };
+        uint64_t m_bitCount{ 0 };
+        uint64_t m_hashCount{ 0 };
+        std::vector<uint64_t> m_words;
+    };
+
+    //////////////////////////////////////////////////////////////////////////////
+    // Knows which player IDs exist so lookups for players that don't can be turned
+    // away without a DynamoDB read. IDs made by GetPlayerIDForInt up to maxBitmapID
+    // go in a bitmap, one bit per ID and exact. Any other ID goes in a Bloom filter,
+    // which grows by adding filters twice the size of the last at half its false
+    // positive rate, so the overall rate stays under falsePositiveRate however many
+    // players are added. Players that exist are never turned away, but it only knows
+    // about players it was built or loaded with, or that were added since
+    class PlayerExistenceFilter
+    {
+    public:
+        PlayerExistenceFilter(uint64_t maxBitmapID, size_t expectedPlayers, double falsePositiveRate)
+            : m_maxBitmapID{ maxBitmapID }
+            , m_expectedPlayers{ std::max<size_t>(1, expectedPlayers) }
+            , m_falsePositiveRate{ falsePositiveRate }
+        {
+        }
+
+        void Clear()
+        {
+            std::lock_guard<std::mutex> lock{ m_mutex };
+            m_bitmap.clear();
+            m_bloomFilters.clear();
+            m_playerCount = 0;
+        }
+
+        // swaps the contents, used to build a filter on the side and put it in place when it's done
+        void Swap(PlayerExistenceFilter& other)
+        {
+            std::lock(m_mutex, other.m_mutex);
+            std::lock_guard<std::mutex> lock{ m_mutex, std::adopt_lock };
+            std::lock_guard<std::mutex> otherLock{ other.m_mutex, std::adopt_lock };
+            std::swap(m_playerCount, other.m_playerCount);
+            m_bitmap.swap(other.m_bitmap);
+            m_bloomFilters.swap(other.m_bloomFilters);
+        }
+
+        // Adding a player that's already known changes nothing. A new ID the Bloom
+        // filters already let through isn't added or counted either, it can't be
+        // told apart from a repeat and is already reported as existing
+        void Add(const std::string& ID)
+        {
+            std::lock_guard<std::mutex> lock{ m_mutex };
+            uint64_t numericID{ 0 };
+            if (GetNumericID(ID, numericID))
+            {
+                const size_t wordIdx{ static_cast<size_t>(numericID / 64) };
+                if (wordIdx >= m_bitmap.size())
+                {
+                    // grow geometrically, players are usually added in ID order
+                    m_bitmap.resize(std::max(wordIdx + 1, m_bitmap.size() * 2));
+                }
+                const uint64_t mask{ 1ull << (numericID % 64) };
+                if ((m_bitmap[wordIdx] & mask) == 0)
+                {
+                    m_bitmap[wordIdx] |= mask;
+                    ++m_playerCount;
+                }
+                return;
+            }
+
+            const uint64_t hash{ HashKey(ID) };
+            if (std::any_of(m_bloomFilters.begin(), m_bloomFilters.end(), [hash](const BloomFilter& filter) { return filter.MightContain(hash); }))
+            {
+                return;
+            }
+            if (m_bloomFilters.empty() || m_bloomFilters.back().IsFull())
+            {
+                const size_t filterIdx{ m_bloomFilters.size() };
+                // the first filter gets half the rate and each one after it half again, which sums to the target
+                const double rate{ m_falsePositiveRate / std::pow(2.0, static_cast<double>(filterIdx + 1)) };
+                m_bloomFilters.emplace_back(m_expectedPlayers << std::min<size_t>(filterIdx, 20), rate);
+            }
+            if (m_bloomFilters.back().Add(hash))
+            {
+                ++m_playerCount;
+            }
+        }
+
+        // false means the player definitely doesn't exist
+        bool MightExist(const std::string& ID) const
+        {
+            std::lock_guard<std::mutex> lock{ m_mutex };
+            uint64_t numericID{ 0 };
+            if (GetNumericID(ID, numericID))
+            {
+                const size_t wordIdx{ static_cast<size_t>(numericID / 64) };
+                return wordIdx < m_bitmap.size() && (m_bitmap[wordIdx] & (1ull << (numericID % 64))) != 0;
+            }
+
+            const uint64_t hash{ HashKey(ID) };
+            return std::any_of(m_bloomFilters.begin(), m_bloomFilters.end(), [hash](const BloomFilter& filter) { return filter.MightContain(hash); });
+        }
+
+        size_t GetPlayerCount() const
+        {
+            std::lock_guard<std::mutex> lock{ m_mutex };
+            return m_playerCount;
+        }
+
+        size_t GetMemoryBytes() const
+        {
+            std::lock_guard<std::mutex> lock{ m_mutex };
+            size_t memoryBytes{ m_bitmap.size() * sizeof(uint64_t) };
+            for (const BloomFilter& filter : m_bloomFilters)
+            {
+                memoryBytes += filter.GetMemoryBytes();
+            }
+            return memoryBytes;
+        }
+
+        bool Save(const std::string& fileName) const
+        {
+            std::lock_guard<std::mutex> lock{ m_mutex };
+            std::ofstream file{ fileName, std::ios::binary | std::ios::trunc };
+            file.write(PLAYER_FILTER_MAGIC, sizeof(PLAYER_FILTER_MAGIC));
+            PlayerFilterDetail::WriteInt(file, m_playerCount);
+            PlayerFilterDetail::WriteInt(file, m_bitmap.size());
+            PlayerFilterDetail::WriteWords(file, m_bitmap);
+            PlayerFilterDetail::WriteInt(file, m_bloomFilters.size());
+            for (const BloomFilter& filter : m_bloomFilters)
+            {
+                filter.Write(file);
+            }
+            return static_cast<bool>(file);
+        }
+
+        // leaves the filter as it was if the file can't be read
+        bool Load(const std::string& fileName)
+        {
+            std::ifstream file{ fileName, std::ios::binary };
+            char magic[sizeof(PLAYER_FILTER_MAGIC)];
+            if (!file.read(magic, sizeof(magic)) || !std::equal(magic, magic + sizeof(magic), PLAYER_FILTER_MAGIC))
+            {
+                return false;
+            }
+
+            uint64_t playerCount{ 0 };
+            uint64_t wordCount{ 0 };
+            std::vector<uint64_t> bitmap;
+            if (!PlayerFilterDetail::ReadInt(file, playerCount) || !PlayerFilterDetail::ReadInt(file, wordCount)
+                || !PlayerFilterDetail::ReadWords(file, wordCount, bitmap))
+            {
+                return false;
+            }
+
+            uint64_t filterCount{ 0 };
+            if (!PlayerFilterDetail::ReadInt(file, filterCount) || filterCount > 64)
+            {
+                return false;
+            }
+            std::vector<BloomFilter> bloomFilters;
+            for (uint64_t filterIdx{ 0 }; filterIdx < filterCount; ++filterIdx)
+            {
+                bloomFilters.emplace_back(1, m_falsePositiveRate);
+                if (!bloomFilters.back().Read(file))
+                {
+                    return false;
+                }
+            }
+
+            std::lock_guard<std::mutex> lock{ m_mutex };
+            m_playerCount = static_cast<size_t>(playerCount);
+            m_bitmap.swap(bitmap);
+            m_bloomFilters.swap(bloomFilters);
+            return true;
+        }
+
+    private:
+        // true for IDs in the GetPlayerIDForInt format that fit in the bitmap
+        bool GetNumericID(const std::string& ID, uint64_t& numericID) const
+        {
+            if (ID.size() != static_cast<size_t>(ID_SIZE))
+            {
+                return false;
+            }
+            numericID = 0;
+            for (char idChar : ID)
+            {
+                if (idChar < '0' || idChar > '9')
+                {
+                    return false;
+                }
+                numericID = numericID * 10 + static_cast<uint64_t>(idChar - '0');
+                if (numericID > m_maxBitmapID)
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        mutable std::mutex m_mutex;
+        const uint64_t m_maxBitmapID;
+        const size_t m_expectedPlayers;
+        const double m_falsePositiveRate;
+        size_t m_playerCount{ 0 };
+        std::vector<uint64_t> m_bitmap;
+        std::vector<BloomFilter> m_bloomFilters;
+    };
+}
@@ -0,0 +1,275 @@
+#pragma once
+// Standard library
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <thread>
+#include <vector>
+
+// Project includes
+#include "../Common/common.h"
+
+namespace AmazingRPG
+{
+    //////////////////////////////////////////////////////////////////////////////
+    // How a single stat is spread across the generated population
+    struct StatDistribution
+    {
+        enum class Type { Uniform, Normal };
+
+        Type type{ Type::Uniform };
+        double min{ 0.0 };
+        double max{ 0.0 };
+        // only used by Normal, values outside of [min, max] are redrawn
+        double mean{ 0.0 };
+        double stddev{ 1.0 };
+
+        static StatDistribution MakeUniform(int min, int max)
+        {
+            StatDistribution dist;
+            dist.type = Type::Uniform;
+            dist.min = min;
+            dist.max = max;
+            return dist;
+        }
+
+        // min and max are 3 standard deviations from average, so we get
+        // a decidedly normal population with some outliers
+        static StatDistribution MakeNormal(double min, double max)
+        {
+            StatDistribution dist;
+            dist.type = Type::Normal;
+            dist.min = min;
+            dist.max = max;
+            dist.mean = (max + min) / 2.0;
+            dist.stddev = (max - min) / 6.0;
+            return dist;
+        }
+    };
+
+    struct PlayerGeneratorSettings
+    {
+        // the same seed always produces the same players, no matter how many threads are used
+        uint64_t seed{ 0 };
+        // 0 uses one thread per hardware thread
+        unsigned int threadCount{ 0 };
+        // players generated per block, each thread works through one block at a time
+        size_t blockSize{ 16384 };
+
+        StatDistribution level{ StatDistribution::MakeUniform(1, 60) };
+        StatDistribution strength{ StatDistribution::MakeNormal(3.0, 18.0) };
+        StatDistribution intellect{ StatDistribution::MakeNormal(3.0, 18.0) };
+    };
+
+    //////////////////////////////////////////////////////////////////////////////
+    // Columnar player storage. Player IDs aren't stored, the player at row N
+    // has the ID GetPlayerIDForInt(firstIndex + N)
+    struct PlayerColumns
+    {
+        size_t firstIndex{ 0 };
+        size_t count{ 0 };
+        std::vector<int> level;
+        std::vector<int> strength;
+        std::vector<int> intellect;
+
+        void Resize(size_t newCount)
+        {
+            count = newCount;
+            level.resize(newCount);
+            strength.resize(newCount);
+            intellect.resize(newCount);
+        }
+
+        PlayerDesc GetPlayerDesc(size_t row) const
+        {
+            PlayerDesc playerDesc;
+            playerDesc.id = GetPlayerIDForInt(static_cast<int>(firstIndex + row));
+            playerDesc.level = level[row];
+            playerDesc.strength = strength[row];
+            playerDesc.intellect = intellect[row];
+            return playerDesc;
+        }
+    };
+
+    // Called from the generator threads once per block, so it must be thread safe.
+    // The columns are reused for the next block once the sink returns.
+    using PlayerSink = std::function<void(const PlayerColumns&)>;
+
+    namespace PlayerGeneratorDetail
+    {
+        // each stat gets its own stream so adding a stat doesn't change the others
+        const uint64_t LEVEL_STREAM{ 0x4C564C00u };
+        const uint64_t STRENGTH_STREAM{ 0x53545200u };
+        const uint64_t INTELLECT_STREAM{ 0x494E5400u };
+
+        // redraws allowed per value before we give up and clamp, at 3 standard
+        // deviations this is only hit about once in 10^40 draws
+        const uint64_t MAX_ATTEMPTS{ 16 };
+
+        // Counter based random numbers (SplitMix64 finalizer). Every value only depends
+        // on the seed, the stream and the counter, so threads never share any state
+        inline uint64_t CounterHash(uint64_t seed, uint64_t stream, uint64_t counter)
+        {
+            uint64_t z{ seed ^ (stream * 0xD1B54A32D192ED03ull) };
+            z += (counter + 1) * 0x9E3779B97F4A7C15ull;
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+            return z ^ (z >> 31);
+        }
+
+        // uniform double in [0, 1)
+        inline double ToUnitDouble(uint64_t bits)
+        {
+            return static_cast<double>(bits >> 11) * (1.0 / 9007199254740992.0);
+        }
+
+        inline int RoundStat(double value)
+        {
+            return static_cast<int>(std::floor(value + 0.5));
+        }
+
+        inline void FillUniform(const StatDistribution& dist, uint64_t seed, uint64_t stream, size_t firstIndex, int* out, size_t count)
+        {
+            const double range{ dist.max - dist.min + 1.0 };
+            for (size_t row{ 0 }; row < count; ++row)
+            {
+                double value{ dist.min + std::floor(ToUnitDouble(CounterHash(seed, stream, firstIndex + row)) * range) };
+                out[row] = static_cast<int>(std::min(value, dist.max));
+            }
+        }
+
+        // Box-Muller produces two normal values per pair of uniforms, so players are
+        // drawn in pairs (2N, 2N + 1). Out of range values are redrawn from the next
+        // counter for that player, which keeps the result independent of the block layout
+        inline void FillNormal(const StatDistribution& dist, uint64_t seed, uint64_t stream, size_t firstIndex, int* out, size_t count)
+        {
+            const double TWO_PI{ 6.283185307179586 };
+            size_t row{ 0 };
+            while (row < count)
+            {
+                const size_t index{ firstIndex + row };
+                const size_t pairIndex{ index / 2 };
+                const bool secondOfPair{ (index & 1) != 0 };
+                const bool wantBoth{ !secondOfPair && row + 1 < count };
+
+                bool firstDone{ secondOfPair };
+                bool secondDone{ !secondOfPair && !wantBoth };
+                for (uint64_t attempt{ 0 }; attempt < MAX_ATTEMPTS && !(firstDone && secondDone); ++attempt)
+                {
+                    const uint64_t counter{ (pairIndex * MAX_ATTEMPTS + attempt) * 2 };
+                    // 1 - u keeps us away from log(0)
+                    const double u1{ 1.0 - ToUnitDouble(CounterHash(seed, stream, counter)) };
+                    const double u2{ ToUnitDouble(CounterHash(seed, stream, counter + 1)) };
+                    const double radius{ std::sqrt(-2.0 * std::log(u1)) * dist.stddev };
+                    const double first{ dist.mean + radius * std::cos(TWO_PI * u2) };
+                    const double second{ dist.mean + radius * std::sin(TWO_PI * u2) };
+
+                    if (!firstDone && first >= dist.min && first <= dist.max)
+                    {
+                        out[row] = RoundStat(first);
+                        firstDone = true;
+                    }
+                    if (!secondDone && second >= dist.min && second <= dist.max)
+                    {
+                        out[secondOfPair ? row : row + 1] = RoundStat(second);
+                        secondDone = true;
+                    }
+                }
+
+                if (!firstDone)
+                {
+                    out[row] = RoundStat(dist.mean);
+                }
+                if (!secondDone)
+                {
+                    out[secondOfPair ? row : row + 1] = RoundStat(dist.mean);
+                }
+                row += wantBoth ? 2 : 1;
+            }
+        }
+
+        inline void FillStat(const StatDistribution& dist, uint64_t seed, uint64_t stream, size_t firstIndex, int* out, size_t count)
+        {
+            if (dist.type == StatDistribution::Type::Normal)
+            {
+                FillNormal(dist, seed, stream, firstIndex, out, count);
+            }
+            else
+            {
+                FillUniform(dist, seed, stream, firstIndex, out, count);
+            }
+        }
+
+        inline void FillBlock(const PlayerGeneratorSettings& settings, size_t firstIndex, size_t count, int* level, int* strength, int* intellect)
+        {
+            FillStat(settings.level, settings.seed, LEVEL_STREAM, firstIndex, level, count);
+            FillStat(settings.strength, settings.seed, STRENGTH_STREAM, firstIndex, strength, count);
+            FillStat(settings.intellect, settings.seed, INTELLECT_STREAM, firstIndex, intellect, count);
+        }
+
+        inline unsigned int GetThreadCount(const PlayerGeneratorSettings& settings, size_t blockCount)
+        {
+            unsigned int threadCount{ settings.threadCount };
+            if (threadCount == 0)
+            {
+                threadCount = std::max(1u, std::thread::hardware_concurrency());
+            }
+            return static_cast<unsigned int>(std::max<size_t>(1, std::min<size_t>(threadCount, blockCount)));
+        }
+
+        // blocks are handed out round robin, which is good enough as every block costs the same
+        inline void RunBlocks(const PlayerGeneratorSettings& settings, size_t count, const std::function<void(size_t, size_t)>& runBlock)
+        {
+            const size_t blockSize{ std::max<size_t>(2, settings.blockSize) };
+            const size_t blockCount{ (count + blockSize - 1) / blockSize };
+            const unsigned int threadCount{ GetThreadCount(settings, blockCount) };
+
+            auto worker = [&](unsigned int threadIdx)
+            {
+                for (size_t blockIdx{ threadIdx }; blockIdx < blockCount; blockIdx += threadCount)
+                {
+                    const size_t blockStart{ blockIdx * blockSize };
+                    runBlock(blockStart, std::min(blockSize, count - blockStart));
+                }
+            };
+
+            std::vector<std::thread> threads;
+            for (unsigned int threadIdx{ 1 }; threadIdx < threadCount; ++threadIdx)
+            {
+                threads.emplace_back(worker, threadIdx);
+            }
+            worker(0);
+            for (auto& thread : threads)
+            {
+                thread.join();
+            }
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////////////
+    // Fills a preallocated set of columns, players.firstIndex is the ID of the first row
+    inline void GeneratePlayers(const PlayerGeneratorSettings& settings, PlayerColumns& players)
+    {
+        PlayerGeneratorDetail::RunBlocks(settings, players.count, [&](size_t blockStart, size_t blockCount)
+        {
+            PlayerGeneratorDetail::FillBlock(settings, players.firstIndex + blockStart, blockCount,
+                players.level.data() + blockStart, players.strength.data() + blockStart, players.intellect.data() + blockStart);
+        });
+    }
+
+    // Streams players in blocks to the sink so memory stays bounded by threads * blockSize
+    inline void GeneratePlayers(const PlayerGeneratorSettings& settings, size_t firstIndex, size_t count, const PlayerSink& sink)
+    {
+        PlayerGeneratorDetail::RunBlocks(settings, count, [&](size_t blockStart, size_t blockCount)
+        {
+            // one buffer per thread, reused for every block that thread works on
+            thread_local PlayerColumns block;
+            block.Resize(blockCount);
+            block.firstIndex = firstIndex + blockStart;
+            PlayerGeneratorDetail::FillBlock(settings, block.firstIndex, blockCount,
+                block.level.data(), block.strength.data(), block.intellect.data());
+            sink(block);
+        });
+    }
+}
@@ -0,0 +1,269 @@
+#pragma once
+// Standard library
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+// Project includes
+#include "../Common/common.h"
+
+namespace AmazingRPG
+{
+    //////////////////////////////////////////////////////////////////////////////
+    // Parsing and encoding of the socket protocol described in common.h. Nothing
+    // in here touches sockets or DynamoDB so it can be benchmarked on its own
+
+    struct PlayerRequest
+    {
+        char controlCode{ 0 };
+        std::string playerID;
+        // the version the client already has, only sent with VIEW_IF_NEWER
+        unsigned long long knownVersion{ 0 };
+        // where to carry on listing from, only sent with INVENTORY
+        std::string continuationToken;
+        // the client sent more than one request's worth, only the first gets processed
+        bool hasExtraData{ false };
+    };
+
+    // all requests other than GRANT are a control code followed by 30 characters of ID,
+    // VIEW_IF_NEWER adds the client's version after the ID and INVENTORY can add a
+    // continuation token
+    inline bool ParsePlayerRequest(const char* buffer, size_t length, PlayerRequest& request, std::string& error)
+    {
+        const size_t requestSize{ length > 0 && buffer[0] == VIEW_IF_NEWER ? ID_SIZE + 1 + VERSION_SIZE : ID_SIZE + 1 };
+        if (length < requestSize)
+        {
+            error = "Socket receieved less data than expected, sending error to user";
+            return false;
+        }
+
+        request.controlCode = buffer[0];
+        request.playerID.assign(buffer + 1, ID_SIZE);
+        request.knownVersion = request.controlCode == VIEW_IF_NEWER ? ReadLittleEndian(buffer + 1 + ID_SIZE, VERSION_SIZE) : 0;
+        request.continuationToken.clear();
+        if (request.controlCode == INVENTORY)
+        {
+            if (length - requestSize > MAX_CONTINUATION_TOKEN_SIZE)
+            {
+                error = "Continuation token is too long";
+                return false;
+            }
+            request.continuationToken.assign(buffer + requestSize, length - requestSize);
+            request.hasExtraData = false;
+            return true;
+        }
+        request.hasExtraData = length > requestSize;
+        return true;
+    }
+
+    struct GrantRequest
+    {
+        char fieldCode{ 0 };
+        int amount{ 0 };
+        std::vector<std::string> playerIDs;
+    };
+
+    inline bool ParseGrantRequest(const char* buffer, size_t length, GrantRequest& request, std::string& error)
+    {
+        const char* amountEnd{ static_cast<const char*>(memchr(buffer, GRANT_AMOUNT_END, length)) };
+        if (length < 3 || buffer[0] != GRANT || amountEnd == nullptr)
+        {
+            error = "Badly formed grant request";
+            return false;
+        }
+
+        request.fieldCode = buffer[1];
+        if (request.fieldCode != STR && request.fieldCode != INT)
+        {
+            error = "Grant request has an unknown attribute";
+            return false;
+        }
+
+        // parse by hand, stoi would need a copy and throws on bad input
+        const char* amountChar{ buffer + 2 };
+        bool negative{ amountChar < amountEnd && *amountChar == '-' };
+        if (negative)
+        {
+            ++amountChar;
+        }
+        if (amountChar == amountEnd || amountEnd - amountChar > 9)
+        {
+            error = "Grant request has an invalid amount";
+            return false;
+        }
+        int amount{ 0 };
+        for (; amountChar < amountEnd; ++amountChar)
+        {
+            if (*amountChar < '0' || *amountChar > '9')
+            {
+                error = "Grant request has an invalid amount";
+                return false;
+            }
+            amount = amount * 10 + (*amountChar - '0');
+        }
+        if (amount > MAX_GRANT_AMOUNT)
+        {
+            error = "Grant amounts are at most " + std::to_string(MAX_GRANT_AMOUNT) + " either way";
+            return false;
+        }
+        request.amount = negative ? -amount : amount;
+
+        const char* idsStart{ amountEnd + 1 };
+        size_t idsLength{ static_cast<size_t>(buffer + length - idsStart) };
+        if (idsLength == 0 || idsLength % ID_SIZE != 0 || idsLength / ID_SIZE > MAX_GRANT_PLAYERS)
+        {
+            error = "Grant request needs between 1 and " + std::to_string(MAX_GRANT_PLAYERS) + " player IDs";
+            return false;
+        }
+
+        request.playerIDs.clear();
+        request.playerIDs.reserve(idsLength / ID_SIZE);
+        for (const char* idStart{ idsStart }; idStart < buffer + length; idStart += ID_SIZE)
+        {
+            request.playerIDs.emplace_back(idStart, ID_SIZE);
+        }
+        return true;
+    }
+
+    // One player's line of a grant reply, see GRANT in common.h. A status too long
+    // for the line is cut short and ends in "..." so the line still fits
+    inline void AppendGrantResult(std::string& message, const std::string& playerID, const std::string& status)
+    {
+        const std::string ELLIPSIS{ "..." };
+        const size_t maxStatusSize{ MAX_GRANT_RESULT_SIZE - playerID.size() - 2 };
+        message += playerID;
+        message += ' ';
+        if (status.size() <= maxStatusSize)
+        {
+            message += status;
+        }
+        else
+        {
+            message.append(status, 0, maxStatusSize - ELLIPSIS.size());
+            message += ELLIPSIS;
+        }
+        message += '\n';
+    }
+
+    // see PUSH_DELTA in common.h for the layout
+    inline std::string EncodePlayerDelta(const std::string& ID, const std::map<char, int>& fields)
+    {
+        std::string message;
+        message.reserve(1 + ID.size() + fields.size() * 8 + 1);
+        message += PUSH_DELTA;
+        message += ID;
+        for (const auto& field : fields)
+        {
+            message += field.first;
+            message += std::to_string(field.second);
+            message += PUSH_DELTA_FIELD_END;
+        }
+        message += PUSH_DELTA_END;
+        return message;
+    }
+
+    // see VERSIONED_DELTA in common.h for the layout
+    inline std::string EncodeVersionedDelta(unsigned long long version, const std::map<char, int>& fields)
+    {
+        std::string message;
+        message.reserve(1 + VERSION_SIZE + 1 + fields.size() * (1 + DELTA_VALUE_SIZE));
+        message += VERSIONED_DELTA;
+        AppendLittleEndian(message, version, VERSION_SIZE);
+        message += static_cast<char>(fields.size());
+        for (const auto& field : fields)
+        {
+            message += field.first;
+            AppendLittleEndian(message, static_cast<unsigned int>(field.second), DELTA_VALUE_SIZE);
+        }
+        return message;
+    }
+
+    // Continuation tokens are the hex of the player ID followed by the last item ID
+    // sent. They aren't signed or secret, the player ID is only there so a token is
+    // turned down when it's sent with a different player than the listing it came from
+    inline std::string EncodeContinuationToken(const std::string& playerID, const std::string& lastItemID)
+    {
+        // no item left to carry on from, the listing is finished
+        if (lastItemID.empty())
+        {
+            return {};
+        }
+
+        const char HEX_DIGITS[]{ "0123456789abcdef" };
+        const std::string tokenText{ playerID + lastItemID };
+        std::string token;
+        token.reserve(tokenText.size() * 2);
+        for (char itemChar : tokenText)
+        {
+            token += HEX_DIGITS[(static_cast<unsigned char>(itemChar) >> 4) & 0xF];
+            token += HEX_DIGITS[static_cast<unsigned char>(itemChar) & 0xF];
+        }
+        return token;
+    }
+
+    // An empty token decodes to an empty item ID, which means start from the first
+    // item. False if the token is malformed or was made for another player
+    inline bool DecodeContinuationToken(const std::string& token, const std::string& playerID, std::string& lastItemID)
+    {
+        if (token.empty())
+        {
+            lastItemID.clear();
+            return true;
+        }
+        if (token.size() % 2 != 0 || token.size() > MAX_CONTINUATION_TOKEN_SIZE || token.size() <= playerID.size() * 2)
+        {
+            return false;
+        }
+
+        auto hexValue = [](char hexChar) -> int
+        {
+            if (hexChar >= '0' && hexChar <= '9')
+            {
+                return hexChar - '0';
+            }
+            if (hexChar >= 'a' && hexChar <= 'f')
+            {
+                return hexChar - 'a' + 10;
+            }
+            return -1;
+        };
+
+        lastItemID.clear();
+        for (size_t charIdx{ 0 }; charIdx < token.size(); charIdx += 2)
+        {
+            int high{ hexValue(token[charIdx]) };
+            int low{ hexValue(token[charIdx + 1]) };
+            if (high < 0 || low < 0)
+            {
+                return false;
+            }
+            lastItemID += static_cast<char>(high * 16 + low);
+        }
+        if (lastItemID.compare(0, playerID.size(), playerID) != 0)
+        {
+            return false;
+        }
+        lastItemID.erase(0, playerID.size());
+        return true;
+    }
+
+    // see INVENTORY in common.h for the layout, appends so a page is built in one string
+    inline void AppendInventoryItem(std::string& message, const InventoryItem& item)
+    {
+        message += INVENTORY_ITEM;
+        message += item.itemID;
+        message += PUSH_DELTA_FIELD_END;
+        message += std::to_string(item.count);
+        message += PUSH_DELTA_FIELD_END;
+        message += item.name;
+        message += PUSH_DELTA_END;
+    }
+
+    inline void AppendInventoryEnd(std::string& message, const std::string& continuationToken)
+    {
+        message += INVENTORY_END;
+        message += continuationToken;
+        message += PUSH_DELTA_END;
+    }
+}
@@ -0,0 +1,213 @@
+#pragma once
+// Standard library
+#include <climits>
+#include <map>
+#include <string>
+#include <vector>
+
+// AWS C++ SDK
+#include <aws/dynamodb/model/AttributeValue.h>
+#include <aws/dynamodb/model/BatchWriteItemRequest.h>
+#include <aws/dynamodb/model/PutRequest.h>
+#include <aws/dynamodb/model/QueryRequest.h>
+#include <aws/dynamodb/model/ScanRequest.h>
+#include <aws/dynamodb/model/UpdateItemRequest.h>
+#include <aws/dynamodb/model/WriteRequest.h>
+
+// Project includes
+#include "../Common/common.h"
+
+namespace AmazingRPG
+{
+    //////////////////////////////////////////////////////////////////////////////
+    // data keys
+    // When naming your keys, be careful of reserved words https://docs.aws.amazon.com/amazondynamodb/latest/developerguide/ReservedWords.html
+    const std::string PLAYER_DATA_TABLE_NAME{ "PlayerData" };
+    const std::string DATA_KEY_ID{ "PlayerID" };
+    const std::string DATA_KEY_LEVEL{ "PlayerLevel" };
+    const std::string DATA_KEY_STRENGTH{ "PlayerStrength" };
+    const std::string DATA_KEY_INTELLECT{ "PlayerIntellect" };
+    // counts the writes to a player, players written before it existed are version 0
+    const std::string DATA_KEY_VERSION{ "PlayerVersion" };
+
+    const size_t MAX_DYNAMODB_BATCH_ITEMS{ 25 };
+
+    //////////////////////////////////////////////////////////////////////////////
+    // Building DynamoDB requests for the PlayerData table and reading its items.
+    // This only builds and reads the SDK model objects, sending them is up to the caller
+
+    // protocol field codes (STR, INT) to their attribute, empty if there isn't one
+    inline const std::string& GetAttributeForFieldCode(char fieldCode)
+    {
+        static const std::string NO_ATTRIBUTE;
+        if (fieldCode == STR)
+        {
+            return DATA_KEY_STRENGTH;
+        }
+        if (fieldCode == INT)
+        {
+            return DATA_KEY_INTELLECT;
+        }
+        return NO_ATTRIBUTE;
+    }
+
+    inline char GetFieldCodeForAttribute(const std::string& attributeKey)
+    {
+        if (attributeKey == DATA_KEY_STRENGTH)
+        {
+            return STR;
+        }
+        if (attributeKey == DATA_KEY_INTELLECT)
+        {
+            return INT;
+        }
+        return 0;
+    }
+
+    inline Aws::DynamoDB::Model::QueryRequest MakePlayerQueryRequest(const std::string& ID)
+    {
+        Aws::DynamoDB::Model::QueryRequest queryRequest;
+        queryRequest.SetTableName(PLAYER_DATA_TABLE_NAME);
+        std::string conditionExpression{ DATA_KEY_ID };
+        conditionExpression += " = :id";
+        queryRequest.SetKeyConditionExpression(conditionExpression); //https://docs.aws.amazon.com/amazondynamodb/latest/developerguide/Query.html
+        Aws::DynamoDB::Model::AttributeValue avID;
+        avID.SetS(ID);
+        std::map<std::string, Aws::DynamoDB::Model::AttributeValue> attributeValues;
+        attributeValues[":id"] = avID;
+        queryRequest.SetExpressionAttributeValues(attributeValues);
+        return queryRequest;
+    }
+
+    // one page of player IDs, pass the previous page's LastEvaluatedKey to get the next one
+    inline Aws::DynamoDB::Model::ScanRequest MakePlayerIDScanRequest(const std::map<std::string, Aws::DynamoDB::Model::AttributeValue>& exclusiveStartKey)
+    {
+        Aws::DynamoDB::Model::ScanRequest scanRequest;
+        scanRequest.SetTableName(PLAYER_DATA_TABLE_NAME);
+        scanRequest.SetProjectionExpression(DATA_KEY_ID);
+        if (!exclusiveStartKey.empty())
+        {
+            scanRequest.SetExclusiveStartKey(exclusiveStartKey);
+        }
+        return scanRequest;
+    }
+
+    // false if the item is missing one of the player attributes or a stat isn't an int
+    template <typename Item>
+    bool ReadPlayerDescFromItem(const Item& item, PlayerDesc& playerDesc)
+    {
+        auto ID{ item.find(DATA_KEY_ID) };
+        auto strength{ item.find(DATA_KEY_STRENGTH) };
+        auto intellect{ item.find(DATA_KEY_INTELLECT) };
+        if (ID == item.end() || strength == item.end() || intellect == item.end())
+        {
+            return false;
+        }
+
+        long long strengthValue{ 0 };
+        long long intellectValue{ 0 };
+        if (!ParseInteger(strength->second.GetN(), INT_MIN, INT_MAX, strengthValue) || !ParseInteger(intellect->second.GetN(), INT_MIN, INT_MAX, intellectValue))
+        {
+            return false;
+        }
+        playerDesc.id = ID->second.GetS();   // we already know this, just showing how to read it
+        playerDesc.strength = static_cast<int>(strengthValue);
+        playerDesc.intellect = static_cast<int>(intellectValue);
+
+        auto version{ item.find(DATA_KEY_VERSION) };
+        playerDesc.version = 0;
+        return version == item.end() || ParseUnsigned(version->second.GetN(), playerDesc.version);
+    }
+
+    // every write bumps the version in the same update, so it can't get out of step with the data
+    inline std::map<std::string, Aws::DynamoDB::Model::AttributeValue> MakeVersionIncrementValues()
+    {
+        Aws::DynamoDB::Model::AttributeValue avOne;
+        avOne.SetN("1");
+        std::map<std::string, Aws::DynamoDB::Model::AttributeValue> attributeValues;
+        attributeValues[":one"] = avOne;
+        return attributeValues;
+    }
+
+    inline Aws::DynamoDB::Model::UpdateItemRequest MakeSetAttributeRequest(const std::string& ID, const std::string& attributeKey, int newValue)
+    {
+        Aws::DynamoDB::Model::UpdateItemRequest updateItemRequest;
+        updateItemRequest.SetTableName(PLAYER_DATA_TABLE_NAME);
+
+        // It's worth noting that the current AWS C++ SDK example for upating an
+        // item is incorrect, AttributeUpdates are no longer used, you need
+        // to use update expressions instead: https://docs.aws.amazon.com/amazondynamodb/latest/developerguide/Expressions.UpdateExpressions.html
+        Aws::DynamoDB::Model::AttributeValue avID;
+        avID.SetS(ID);
+        updateItemRequest.AddKey(DATA_KEY_ID, avID);
+
+        updateItemRequest.SetUpdateExpression("SET " + attributeKey + " = :l ADD " + DATA_KEY_VERSION + " :one");
+        updateItemRequest.SetReturnValues(Aws::DynamoDB::Model::ReturnValue::UPDATED_NEW);
+
+        Aws::DynamoDB::Model::AttributeValue av;
+        av.SetN(std::to_string(newValue));
+        auto attributeValues{ MakeVersionIncrementValues() };
+        attributeValues[":l"] = av;
+        updateItemRequest.SetExpressionAttributeValues(attributeValues);
+        return updateItemRequest;
+    }
+
+    inline Aws::DynamoDB::Model::BatchWriteItemRequest MakePlayerChunkWriteRequest(const std::vector<PlayerDesc>& playerChunk)
+    {
+        std::vector<Aws::DynamoDB::Model::WriteRequest> writeRequests;
+        writeRequests.reserve(playerChunk.size());
+        for (const auto& chunkItem : playerChunk)
+        {
+            Aws::DynamoDB::Model::AttributeValue avID;
+            avID.SetS(chunkItem.id);
+            Aws::DynamoDB::Model::AttributeValue avStrength;
+            avStrength.SetN(std::to_string(chunkItem.strength));
+            Aws::DynamoDB::Model::AttributeValue avIntellect;
+            avIntellect.SetN(std::to_string(chunkItem.intellect));
+
+            Aws::DynamoDB::Model::PutRequest putRequest;
+            putRequest.AddItem(DATA_KEY_ID, avID);
+            putRequest.AddItem(DATA_KEY_STRENGTH, avStrength);
+            putRequest.AddItem(DATA_KEY_INTELLECT, avIntellect);
+
+            Aws::DynamoDB::Model::WriteRequest curWriteRequest;
+            curWriteRequest.SetPutRequest(putRequest);
+            writeRequests.push_back(curWriteRequest);
+        }
+
+        Aws::DynamoDB::Model::BatchWriteItemRequest batchWriteRequest;
+        batchWriteRequest.AddRequestItems(PLAYER_DATA_TABLE_NAME, writeRequests);
+        return batchWriteRequest;
+    }
+
+    inline Aws::DynamoDB::Model::UpdateItemRequest MakeGrantRequest(const std::string& ID, const std::string& attributeKey, int amount)
+    {
+        Aws::DynamoDB::Model::UpdateItemRequest updateItemRequest;
+        updateItemRequest.SetTableName(PLAYER_DATA_TABLE_NAME);
+
+        Aws::DynamoDB::Model::AttributeValue avID;
+        avID.SetS(ID);
+        updateItemRequest.AddKey(DATA_KEY_ID, avID);
+
+        // ADD applies the change on the DynamoDB side, so there's no read beforehand and
+        // no lost updates when two grants hit the same player
+        updateItemRequest.SetUpdateExpression("ADD " + attributeKey + " :d, " + DATA_KEY_VERSION + " :one");
+        // without the first check ADD would happily create players that don't exist, the
+        // second keeps the stat within an int so it can always be read back
+        const std::string limitCheck{ amount >= 0 ? " <= :limit" : " >= :limit" };
+        updateItemRequest.SetConditionExpression("attribute_exists(" + DATA_KEY_ID + ") AND (attribute_not_exists(" + attributeKey + ") OR "
+            + attributeKey + limitCheck + ")");
+        updateItemRequest.SetReturnValues(Aws::DynamoDB::Model::ReturnValue::UPDATED_NEW);
+
+        Aws::DynamoDB::Model::AttributeValue avAmount;
+        avAmount.SetN(std::to_string(amount));
+        // the furthest the stat can be from the limit in the direction of the change
+        Aws::DynamoDB::Model::AttributeValue avLimit;
+        avLimit.SetN(std::to_string(amount >= 0 ? static_cast<long long>(INT_MAX) - amount : static_cast<long long>(INT_MIN) - amount));
+        auto attributeValues{ MakeVersionIncrementValues() };
+        attributeValues[":d"] = avAmount;
+        attributeValues[":limit"] = avLimit;
+        updateItemRequest.SetExpressionAttributeValues(attributeValues);
+        return updateItemRequest;
+    }
+}
@@ -0,0 +1,113 @@
+#pragma once
+// Standard library
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Project includes
+#include "../Common/common.h"
+
+namespace AmazingRPG
+{
+    //////////////////////////////////////////////////////////////////////////////
+    // Remembers the version at which each field of a player last changed, so a
+    // VIEW_IF_NEWER reply can carry only the fields the client hasn't seen. Only
+    // writes made by this server are known here. Each player has a base version,
+    // the oldest version we can describe changes since. A read that finds a version
+    // we didn't write moves the base up, clients older than the base get every field.
+    // When maxPlayers is reached everything is forgotten, which only costs full replies
+    class PlayerVersionTracker
+    {
+    public:
+        explicit PlayerVersionTracker(size_t maxPlayers)
+            : m_maxPlayers{ maxPlayers }
+        {
+        }
+
+        void OnRead(const PlayerDesc& playerDesc)
+        {
+            std::lock_guard<std::mutex> lock{ m_mutex };
+            auto player{ m_players.find(playerDesc.id) };
+            if (player == m_players.end())
+            {
+                Reset(GetEntry(playerDesc.id), playerDesc.version);
+            }
+            else if (playerDesc.version > player->second.latestVersion)
+            {
+                // written somewhere else, we can't say what changed
+                Reset(player->second, playerDesc.version);
+            }
+        }
+
+        // fieldCode is 0 for changes that aren't sent as a field, those need a full reply
+        void OnWrite(const std::string& ID, char fieldCode, unsigned long long newVersion)
+        {
+            std::lock_guard<std::mutex> lock{ m_mutex };
+            PlayerVersions& player{ GetEntry(ID) };
+            if (fieldCode == 0 || newVersion == 0)
+            {
+                Reset(player, newVersion);
+                return;
+            }
+            if (newVersion != player.latestVersion + 1)
+            {
+                // we missed a write in between, only this one is known
+                Reset(player, newVersion - 1);
+            }
+            player.fieldVersions[fieldCode] = newVersion;
+            player.latestVersion = newVersion;
+        }
+
+        // the fields changed after knownVersion, false when we can't tell and every field has to go
+        bool GetChangedFields(const std::string& ID, unsigned long long knownVersion, unsigned long long currentVersion, std::vector<char>& fieldCodes) const
+        {
+            std::lock_guard<std::mutex> lock{ m_mutex };
+            auto player{ m_players.find(ID) };
+            if (player == m_players.end() || knownVersion < player->second.baseVersion || currentVersion != player->second.latestVersion)
+            {
+                return false;
+            }
+
+            fieldCodes.clear();
+            for (const auto& field : player->second.fieldVersions)
+            {
+                if (field.second > knownVersion)
+                {
+                    fieldCodes.push_back(field.first);
+                }
+            }
+            return true;
+        }
+
+    private:
+        struct PlayerVersions
+        {
+            unsigned long long baseVersion{ 0 };
+            unsigned long long latestVersion{ 0 };
+            // field code to the version it last changed at, only changes after baseVersion
+            std::map<char, unsigned long long> fieldVersions;
+        };
+
+        PlayerVersions& GetEntry(const std::string& ID)
+        {
+            if (m_players.size() >= m_maxPlayers && m_players.count(ID) == 0)
+            {
+                m_players.clear();
+            }
+            return m_players[ID];
+        }
+
+        static void Reset(PlayerVersions& player, unsigned long long version)
+        {
+            player.baseVersion = version;
+            player.latestVersion = version;
+            player.fieldVersions.clear();
+        }
+
+        mutable std::mutex m_mutex;
+        const size_t m_maxPlayers;
+        std::unordered_map<std::string, PlayerVersions> m_players;
+    };
+}
@@ -4,4 +4,80 @@
 namespace AmazingRPG
 {
     const std::string REGION{ Aws::Region::US_EAST_1 };
+
+    // DynamoDB client tuning, see DynamoDBClientPool.h
+    // set the endpoint override to something like "http://localhost:8000" to use DynamoDB Local
+    const std::string DYNAMODB_ENDPOINT_OVERRIDE{};
+    const unsigned DYNAMODB_MAX_CONNECTIONS{ 25 };
+    const long DYNAMODB_CONNECT_TIMEOUT_MS{ 1000 };
+    const long DYNAMODB_REQUEST_TIMEOUT_MS{ 3000 };
+    const bool DYNAMODB_TCP_KEEP_ALIVE{ true };
+    const unsigned long DYNAMODB_TCP_KEEP_ALIVE_INTERVAL_MS{ 30000 };
+    // threads used for the async (Callable/Async) DynamoDB calls
+    const size_t DYNAMODB_EXECUTOR_THREADS{ 8 };
+    // 1 shares a single client, more than 1 gives workers their own client
+    const size_t DYNAMODB_CLIENT_COUNT{ 1 };
+
+    // hedged reads, see HedgedRead.h
+    // how long a socket request has to get its answer from DynamoDB
+    const long REQUEST_DEADLINE_MS{ 1000 };
+    // a second read goes out once the first is slower than this percentile of recent reads
+    const double HEDGE_PERCENTILE{ 95.0 };
+    // hedge delay used until enough reads have been seen
+    const long HEDGE_DEFAULT_DELAY_MS{ 50 };
+    // at most this fraction of reads gets hedged, with a small burst allowance
+    const double HEDGE_BUDGET_RATIO{ 0.1 };
+    const double HEDGE_BUDGET_BURST{ 10.0 };
+
+    // cluster mode, see ClusterRing.h
+    // points each node gets on the hash ring, more points spread players more evenly
+    const int CLUSTER_VIRTUAL_NODES{ 256 };
+
+    // hot key detection, see HotKeys.h
+    // count-min sketch size, 4 rows of 2048 counters keeps overcounting low for thousands of active players
+    const size_t HOT_KEY_SKETCH_WIDTH{ 2048 };
+    const size_t HOT_KEY_SKETCH_DEPTH{ 4 };
+    // most requested players tracked by name
+    const size_t HOT_KEY_TOP_COUNT{ 16 };
+    // requests since the last decay a player needs to be pinned in memory
+    const unsigned HOT_KEY_THRESHOLD{ 50 };
+    // counts are halved after this many requests
+    const unsigned HOT_KEY_DECAY_INTERVAL{ 10000 };
+    // how long a pinned player is served before it is read again
+    const long HOT_KEY_PIN_MS{ 1000 };
+
+    // versioned reads, see PlayerVersions.h
+    // players whose field versions are remembered, past this the server starts over
+    const size_t MAX_TRACKED_PLAYER_VERSIONS{ 100000 };
+
+    // missing player filter, see PlayerFilter.h
+    // chance a request for a player that doesn't exist still goes to DynamoDB, only for IDs outside the bitmap
+    const double PLAYER_FILTER_FALSE_POSITIVE_RATE{ 0.01 };
+    // players the first Bloom filter is sized for, it grows past this
+    const size_t PLAYER_FILTER_EXPECTED_PLAYERS{ 100000 };
+    // numeric IDs up to this are kept one bit each, 16M IDs is 2MB when they're all in use
+    const unsigned long long PLAYER_FILTER_MAX_BITMAP_ID{ 1ull << 24 };
+
+    // inventory listings, see InventoryTable.h
+    // items read from DynamoDB and sent to the client at a time, a connection never has more than one page waiting
+    const int INVENTORY_PAGE_SIZE{ 100 };
+    // pages streamed for one request before the client has to send the continuation token to get more
+    const int INVENTORY_PAGES_PER_REQUEST{ 10 };
+    // page reads running at once across every connection, listings past this wait their turn.
+    // They run on their own client and executor with a thread each, so they never queue
+    // ahead of player reads
+    const size_t INVENTORY_MAX_QUERIES_IN_FLIGHT{ 16 };
+
+    // socket server timers, see TimerWheel.h
+    const long TIMER_TICK_MS{ 10 };
+    // longest the server loop sleeps when no timer is due
+    const long MAX_SELECT_WAIT_MS{ 1000 };
+    // connections that send nothing for this long are closed, unless they're watching a player
+    const long IDLE_CONNECTION_TIMEOUT_MS{ 120000 };
+    // connections that take none of their pending replies for this long are closed
+    const long SEND_TIMEOUT_MS{ 10000 };
+    // how often players watching for changes are pinged so dead connections get noticed
+    const long CLIENT_KEEPALIVE_INTERVAL_MS{ 15000 };
+    const long STATS_REPORT_INTERVAL_MS{ 30000 };
+    const long TRACE_FLUSH_INTERVAL_MS{ 5000 };
 }
\ No newline at end of file
@@ -0,0 +1,324 @@
+#pragma once
+// Standard library
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace AmazingRPG
+{
+    // 0 is never handed out, so it can mean "no timer"
+    using TimerID = uint64_t;
+    const TimerID INVALID_TIMER{ 0 };
+
+    namespace TimerWheelDetail
+    {
+        const int LEVEL_COUNT{ 4 };
+        const int LEVEL0_BITS{ 8 };
+        const int UPPER_BITS{ 6 };
+        const uint64_t LEVEL0_SLOTS{ 1ull << LEVEL0_BITS };
+        const uint64_t UPPER_SLOTS{ 1ull << UPPER_BITS };
+        const uint64_t LEVEL0_MASK{ LEVEL0_SLOTS - 1 };
+        const uint64_t UPPER_MASK{ UPPER_SLOTS - 1 };
+        // the furthest out a timer can be, 2^26 ticks
+        const uint64_t MAX_TICKS{ (1ull << (LEVEL0_BITS + (LEVEL_COUNT - 1) * UPPER_BITS)) - 1 };
+        // end of a slot's list, also marks a node that isn't in a slot
+        const uint32_t NO_TIMER{ UINT32_MAX };
+    }
+
+    //////////////////////////////////////////////////////////////////////////////
+    // Hierarchical timer wheel, scheduling, cancelling and firing a timer are all
+    // O(1) no matter how many timers are armed. Time is split into ticks. The
+    // first level has a slot for each of the next 256 ticks, and each of the 3
+    // levels above has 64 slots that each cover a whole turn of the level below.
+    // When a lower level wraps around, the next slot of the level above is
+    // emptied into it. With 10ms ticks timers can be up to 7 days out, anything
+    // further is clamped to that.
+    // Timers live in one pool linked into their slot by index, so arming and
+    // cancelling doesn't allocate once the pool has grown. Not thread safe,
+    // it's driven by the socket server loop
+    class TimerWheel
+    {
+    public:
+        using Callback = std::function<void()>;
+        using Clock = std::chrono::steady_clock;
+
+        TimerWheel(std::chrono::milliseconds tickLength, Clock::time_point startTime)
+            : m_tickLength{ std::max(tickLength, std::chrono::milliseconds{ 1 }) }
+            , m_startTime{ startTime }
+            , m_slots(TimerWheelDetail::LEVEL0_SLOTS + (TimerWheelDetail::LEVEL_COUNT - 1) * TimerWheelDetail::UPPER_SLOTS, TimerWheelDetail::NO_TIMER)
+        {
+        }
+
+        // fires once, delay is rounded up to whole ticks and is at least one tick
+        TimerID Schedule(std::chrono::milliseconds delay, Callback callback)
+        {
+            return Arm(delay, std::chrono::milliseconds{ 0 }, std::move(callback));
+        }
+
+        // fires every interval until cancelled, cancelling from inside the callback is fine
+        TimerID ScheduleRepeating(std::chrono::milliseconds interval, Callback callback)
+        {
+            return Arm(interval, std::max(interval, m_tickLength), std::move(callback));
+        }
+
+        // false if the timer already fired or was cancelled
+        bool Cancel(TimerID timerID)
+        {
+            uint32_t nodeIdx{ 0 };
+            if (!FindNode(timerID, nodeIdx))
+            {
+                return false;
+            }
+            Unlink(nodeIdx);
+            Release(nodeIdx);
+            return true;
+        }
+
+        // Fires every timer that is due by now, in expiry order to the tick.
+        // Returns how many timers fired
+        size_t Advance(Clock::time_point now)
+        {
+            const uint64_t targetTick{ GetTick(now) };
+            size_t firedCount{ 0 };
+            while (m_currentTick < targetTick)
+            {
+                ++m_currentTick;
+                Cascade();
+                firedCount += FireSlot(static_cast<size_t>(m_currentTick & TimerWheelDetail::LEVEL0_MASK));
+            }
+            return firedCount;
+        }
+
+        // How long until the next timer is due, at most maxWait. Timers on the upper
+        // levels count as due when their slot next cascades, so this can be early. Part
+        // milliseconds round up, a select timeout of 0 before the tick would just spin
+        std::chrono::milliseconds GetTimeUntilNextTimer(Clock::time_point now, std::chrono::milliseconds maxWait) const
+        {
+            if (m_timerCount == 0)
+            {
+                return maxWait;
+            }
+
+            uint64_t nextTick{ m_currentTick + TimerWheelDetail::LEVEL0_SLOTS - (m_currentTick & TimerWheelDetail::LEVEL0_MASK) };
+            for (uint64_t tick{ m_currentTick + 1 }; tick < nextTick; ++tick)
+            {
+                if (m_slots[static_cast<size_t>(tick & TimerWheelDetail::LEVEL0_MASK)] != TimerWheelDetail::NO_TIMER)
+                {
+                    nextTick = tick;
+                    break;
+                }
+            }
+
+            auto dueTime{ m_startTime + m_tickLength * static_cast<long long>(nextTick) };
+            auto untilDue{ std::chrono::duration_cast<std::chrono::milliseconds>(dueTime - now) };
+            if (untilDue < dueTime - now)
+            {
+                ++untilDue;
+            }
+            return std::max(std::chrono::milliseconds{ 0 }, std::min(untilDue, maxWait));
+        }
+
+        size_t GetTimerCount() const { return m_timerCount; }
+
+    private:
+        struct TimerNode
+        {
+            Callback callback;
+            uint64_t expiryTick{ 0 };
+            // ticks between firings, 0 for one shot timers
+            uint64_t intervalTicks{ 0 };
+            // bumped every time the node is released so stale TimerIDs don't match
+            uint32_t generation{ 0 };
+            uint32_t slot{ TimerWheelDetail::NO_TIMER };
+            uint32_t prev{ TimerWheelDetail::NO_TIMER };
+            uint32_t next{ TimerWheelDetail::NO_TIMER };
+            bool armed{ false };
+        };
+
+        uint64_t GetTick(Clock::time_point time) const
+        {
+            if (time <= m_startTime)
+            {
+                return 0;
+            }
+            return static_cast<uint64_t>((time - m_startTime) / m_tickLength);
+        }
+
+        uint64_t ToTicks(std::chrono::milliseconds duration) const
+        {
+            const uint64_t ticks{ static_cast<uint64_t>((duration + m_tickLength - std::chrono::milliseconds{ 1 }) / m_tickLength) };
+            return std::min(std::max<uint64_t>(1, ticks), TimerWheelDetail::MAX_TICKS);
+        }
+
+        TimerID Arm(std::chrono::milliseconds delay, std::chrono::milliseconds interval, Callback callback)
+        {
+            uint32_t nodeIdx{ 0 };
+            if (m_freeNodes.empty())
+            {
+                nodeIdx = static_cast<uint32_t>(m_nodes.size());
+                m_nodes.emplace_back();
+            }
+            else
+            {
+                nodeIdx = m_freeNodes.back();
+                m_freeNodes.pop_back();
+            }
+
+            TimerNode& node{ m_nodes[nodeIdx] };
+            node.callback = std::move(callback);
+            node.expiryTick = m_currentTick + ToTicks(delay);
+            node.intervalTicks = interval.count() > 0 ? ToTicks(interval) : 0;
+            node.armed = true;
+            ++m_timerCount;
+            Link(nodeIdx);
+            return (static_cast<TimerID>(node.generation) << 32) | (nodeIdx + 1);
+        }
+
+        bool FindNode(TimerID timerID, uint32_t& nodeIdx) const
+        {
+            const uint64_t nodeNumber{ timerID & 0xFFFFFFFFull };
+            if (nodeNumber == 0 || nodeNumber > m_nodes.size())
+            {
+                return false;
+            }
+            nodeIdx = static_cast<uint32_t>(nodeNumber - 1);
+            const TimerNode& node{ m_nodes[nodeIdx] };
+            return node.armed && node.generation == static_cast<uint32_t>(timerID >> 32);
+        }
+
+        // the slot a timer belongs in depends on how far out it is from the current tick
+        uint32_t GetSlot(uint64_t expiryTick) const
+        {
+            const uint64_t ticksAway{ expiryTick > m_currentTick ? expiryTick - m_currentTick : 0 };
+            if (ticksAway < TimerWheelDetail::LEVEL0_SLOTS)
+            {
+                return static_cast<uint32_t>(expiryTick & TimerWheelDetail::LEVEL0_MASK);
+            }
+
+            int shift{ TimerWheelDetail::LEVEL0_BITS };
+            for (int level{ 1 }; level < TimerWheelDetail::LEVEL_COUNT; ++level)
+            {
+                if (level == TimerWheelDetail::LEVEL_COUNT - 1 || ticksAway < (1ull << (shift + TimerWheelDetail::UPPER_BITS)))
+                {
+                    return static_cast<uint32_t>(TimerWheelDetail::LEVEL0_SLOTS + (level - 1) * TimerWheelDetail::UPPER_SLOTS + ((expiryTick >> shift) & TimerWheelDetail::UPPER_MASK));
+                }
+                shift += TimerWheelDetail::UPPER_BITS;
+            }
+            return TimerWheelDetail::NO_TIMER;
+        }
+
+        void Link(uint32_t nodeIdx)
+        {
+            TimerNode& node{ m_nodes[nodeIdx] };
+            node.slot = GetSlot(node.expiryTick);
+            node.prev = TimerWheelDetail::NO_TIMER;
+            node.next = m_slots[node.slot];
+            if (node.next != TimerWheelDetail::NO_TIMER)
+            {
+                m_nodes[node.next].prev = nodeIdx;
+            }
+            m_slots[node.slot] = nodeIdx;
+        }
+
+        void Unlink(uint32_t nodeIdx)
+        {
+            TimerNode& node{ m_nodes[nodeIdx] };
+            if (node.prev != TimerWheelDetail::NO_TIMER)
+            {
+                m_nodes[node.prev].next = node.next;
+            }
+            else
+            {
+                m_slots[node.slot] = node.next;
+            }
+            if (node.next != TimerWheelDetail::NO_TIMER)
+            {
+                m_nodes[node.next].prev = node.prev;
+            }
+            node.prev = TimerWheelDetail::NO_TIMER;
+            node.next = TimerWheelDetail::NO_TIMER;
+        }
+
+        void Release(uint32_t nodeIdx)
+        {
+            TimerNode& node{ m_nodes[nodeIdx] };
+            node.callback = nullptr;
+            node.armed = false;
+            ++node.generation;
+            --m_timerCount;
+            m_freeNodes.push_back(nodeIdx);
+        }
+
+        // when the current tick starts a new turn of a level, the matching slot of
+        // the level above is spread back out over the levels below it
+        void Cascade()
+        {
+            int shift{ TimerWheelDetail::LEVEL0_BITS };
+            for (int level{ 1 }; level < TimerWheelDetail::LEVEL_COUNT; ++level)
+            {
+                if ((m_currentTick & ((1ull << shift) - 1)) != 0)
+                {
+                    return;
+                }
+
+                const size_t slot{ TimerWheelDetail::LEVEL0_SLOTS + (level - 1) * TimerWheelDetail::UPPER_SLOTS + ((m_currentTick >> shift) & TimerWheelDetail::UPPER_MASK) };
+                uint32_t nodeIdx{ m_slots[slot] };
+                m_slots[slot] = TimerWheelDetail::NO_TIMER;
+                while (nodeIdx != TimerWheelDetail::NO_TIMER)
+                {
+                    const uint32_t nextIdx{ m_nodes[nodeIdx].next };
+                    Link(nodeIdx);
+                    nodeIdx = nextIdx;
+                }
+                shift += TimerWheelDetail::UPPER_BITS;
+            }
+        }
+
+        size_t FireSlot(size_t slot)
+        {
+            size_t firedCount{ 0 };
+            // callbacks can arm and cancel timers, including ones in this slot,
+            // so always take the head again rather than walking the list
+            while (m_slots[slot] != TimerWheelDetail::NO_TIMER)
+            {
+                const uint32_t nodeIdx{ m_slots[slot] };
+                Unlink(nodeIdx);
+                TimerNode& node{ m_nodes[nodeIdx] };
+                const uint32_t generation{ node.generation };
+                Callback callback{ std::move(node.callback) };
+
+                if (node.intervalTicks > 0)
+                {
+                    node.expiryTick = m_currentTick + node.intervalTicks;
+                    Link(nodeIdx);
+                }
+                else
+                {
+                    Release(nodeIdx);
+                }
+
+                ++firedCount;
+                callback();
+
+                // the pool may have grown during the callback, so look the node up again
+                TimerNode& firedNode{ m_nodes[nodeIdx] };
+                if (firedNode.armed && firedNode.generation == generation)
+                {
+                    firedNode.callback = std::move(callback);
+                }
+            }
+            return firedCount;
+        }
+
+        const std::chrono::milliseconds m_tickLength;
+        const Clock::time_point m_startTime;
+        uint64_t m_currentTick{ 0 };
+        // head of each slot's list, level 0 first then each upper level
+        std::vector<uint32_t> m_slots;
+        std::vector<TimerNode> m_nodes;
+        std::vector<uint32_t> m_freeNodes;
+        size_t m_timerCount{ 0 };
+    };
+}